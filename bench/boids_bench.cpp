@@ -0,0 +1,112 @@
+// Headless flocking benchmark: spawns N boids on an empty map and steps BoidsSystem::updateBoids.
+//
+//   boids_bench [frames] [N ...]
+//
+// Defaults to 60 frames at N = 20, 1000, 10000 and 100000. Reports ns per boid per step,
+// neighbour checks per boid per step and heap allocations per step.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "boids_system.hpp"
+#include "util/alloc_tracker.hpp"
+#include "world.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+#ifndef SQUEAK_TRACK_ALLOCATIONS
+    std::atomic<long long> allocation_count{0};
+#endif
+
+    // one frame at 60 fps
+    const float FRAME_MS = 1000.f / 60.f;
+
+    // steps before measuring, so buffers have grown to the flock size
+    const int WARMUP_FRAMES = 2;
+
+    // same flock every run
+    const uint64_t BENCH_SEED = 1;
+}
+
+#ifdef SQUEAK_TRACK_ALLOCATIONS
+// the tracker already replaces operator new
+static long long allocationCount() {
+    return (long long)AllocTracker::totalAllocations();
+}
+#else
+// count every heap allocation in the process
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static long long allocationCount() {
+    return allocation_count.load();
+}
+#endif
+
+static void runCase(int boid_count, int frames) {
+    World world(BENCH_SEED);
+    BoidsSystem boids(world);
+
+    // the update keeps boids on screen, so spawn them over the whole window
+    vec2 center = vec2(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX) * 0.5f;
+    BoidsSystem::createBoidsFlock(world, nullptr, center, WINDOW_HEIGHT_PX * 0.5f, boid_count);
+
+    for (int i = 0; i < WARMUP_FRAMES; i++)
+        boids.updateBoids(FRAME_MS);
+
+    long long checks = 0;
+    long long allocations_before = allocationCount();
+    auto start = Clock::now();
+    for (int i = 0; i < frames; i++) {
+        boids.updateBoids(FRAME_MS);
+        checks += boids.lastUpdateStats().neighbor_checks;
+    }
+    auto end = Clock::now();
+    long long allocations = allocationCount() - allocations_before;
+
+    double total_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    double steps = (double)boid_count * frames;
+    printf("%8d %10.1f %12.1f %14.1f %12.2f %8d\n",
+        boid_count,
+        total_ns / frames / 1e6,
+        total_ns / steps,
+        checks / steps,
+        (double)allocations / frames,
+        boids.lastUpdateStats().grid_cells);
+}
+
+int main(int argc, char* argv[]) {
+    int frames = 60;
+    std::vector<int> counts = { 20, 1000, 10000, 100000 };
+    if (argc > 1)
+        frames = std::max(1, atoi(argv[1]));
+    if (argc > 2) {
+        counts.clear();
+        for (int i = 2; i < argc; i++)
+            counts.push_back(atoi(argv[i]));
+    }
+
+    printf("%d frames per case\n", frames);
+    printf("%8s %10s %12s %14s %12s %8s\n", "boids", "ms/step", "ns/boid/step", "checks/boid", "allocs/step", "cells");
+    for (int boid_count : counts)
+        runCase(boid_count, frames);
+    return EXIT_SUCCESS;
+}
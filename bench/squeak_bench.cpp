@@ -0,0 +1,305 @@
+// Microbenchmarks for the simulation hot paths, reported as JSON.
+//
+//   squeak_bench [--out FILE] [--filter TEXT]
+//
+// Runs headless (no window, GL context or audio). Each case repeats its body until it has
+// run for at least MIN_CASE_MS (and MIN_ITERATIONS times); per-iteration setup is not timed.
+// Output: { "seed": ..., "benchmarks": [ { "name", "param", "iterations", "ops_per_iteration",
+// "mean_ns", "min_ns", "ns_per_op" }, ... ] }
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "a_star.hpp"
+#include "boids_system.hpp"
+#include "map_system.hpp"
+#include "physics_system.hpp"
+#include "render_system.hpp"
+#include "util/rng.hpp"
+#include "world.hpp"
+#include "world_init.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+    const double MIN_CASE_MS = 250.0;
+    const int MIN_ITERATIONS = 3;
+    const int MAX_ITERATIONS = 100000;
+    const uint64_t BENCH_SEED = 1;
+    const float FRAME_MS = 1000.f / 60.f;
+
+    struct BenchResult {
+        std::string name;
+        std::string param;
+        int iterations = 0;
+        int ops_per_iteration = 1;
+        double mean_ns = 0;
+        double min_ns = 0;
+    };
+
+    std::vector<BenchResult> results;
+    std::string name_filter;
+
+    void runCase(const std::string& name, const std::string& param, int ops_per_iteration,
+                 const std::function<void()>& setup, const std::function<void()>& body) {
+        std::string full_name = name + "/" + param;
+        if (!name_filter.empty() && full_name.find(name_filter) == std::string::npos)
+            return;
+
+        BenchResult result;
+        result.name = name;
+        result.param = param;
+        result.ops_per_iteration = ops_per_iteration;
+        result.min_ns = 1e300;
+
+        double total_ns = 0;
+        while (result.iterations < MAX_ITERATIONS &&
+               (result.iterations < MIN_ITERATIONS || total_ns < MIN_CASE_MS * 1e6)) {
+            if (setup)
+                setup();
+            auto start = Clock::now();
+            body();
+            auto end = Clock::now();
+            double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            total_ns += ns;
+            result.min_ns = std::min(result.min_ns, ns);
+            result.iterations++;
+        }
+        result.mean_ns = total_ns / result.iterations;
+        results.push_back(result);
+
+        // progress on stderr so stdout stays valid JSON
+        fprintf(stderr, "%-32s %10.0f ns/op\n", full_name.c_str(), result.mean_ns / ops_per_iteration);
+    }
+
+    vec2 randomPosition(Rng& rng) {
+        float x = rng.uniform(0.f, (float)WINDOW_WIDTH_PX);
+        float y = rng.uniform(0.f, (float)WINDOW_HEIGHT_PX);
+        return vec2(x, y);
+    }
+
+    // moving sprites with the shared collision mesh, like the cats and projectiles
+    void spawnMovingEntities(World& world, RenderSystem& renderer, int count) {
+        Rng rng(BENCH_SEED);
+        Mesh& mesh = renderer.getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
+        for (int i = 0; i < count; i++) {
+            entt::entity entity = world.registry.create();
+            Motion& motion = world.registry.emplace<Motion>(entity);
+            motion.position = randomPosition(rng);
+            float vx = rng.uniform(-100.f, 100.f);
+            float vy = rng.uniform(-100.f, 100.f);
+            motion.velocity = vec2(vx, vy);
+            motion.scale = vec2(GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX);
+            world.registry.emplace<MeshPtr>(entity, &mesh);
+        }
+    }
+
+    void benchMeshLoading() {
+        const std::vector<std::string> meshes = { "chicken.obj", "portal_bubble.obj", "mousetrap.obj", "everything.obj" };
+        for (const std::string& name : meshes) {
+            runCase("mesh_load_obj", name, 1, nullptr, [&] {
+                std::vector<ColoredVertex> vertices;
+                std::vector<uint16_t> indices;
+                vec2 size;
+                Mesh::loadFromOBJFile(mesh_path(name), vertices, indices, size);
+            });
+        }
+    }
+
+    void benchCollides(World& world, RenderSystem& renderer) {
+        const int calls = 1000;
+        world.registry.clear();
+        spawnMovingEntities(world, renderer, 2);
+        auto view = world.registry.view<Motion>();
+        std::vector<entt::entity> pair(view.begin(), view.end());
+        Motion& first = world.registry.get<Motion>(pair[0]);
+        Motion& second = world.registry.get<Motion>(pair[1]);
+
+        // overlapping and apart, since both exits are hot
+        second.position = first.position + vec2(GRID_CELL_WIDTH_PX * 0.5f, 0.f);
+        runCase("collides", "overlapping", calls, nullptr, [&] {
+            for (int i = 0; i < calls; i++)
+                collides(world, pair[0], pair[1]);
+        });
+        second.position = first.position + vec2(GRID_CELL_WIDTH_PX * 4.f, 0.f);
+        runCase("collides", "apart", calls, nullptr, [&] {
+            for (int i = 0; i < calls; i++)
+                collides(world, pair[0], pair[1]);
+        });
+        world.registry.clear();
+    }
+
+    void benchPhysics(World& world, RenderSystem& renderer) {
+        PhysicsSystem physics(world);
+        for (int count : { 50, 200, 1000 }) {
+            world.registry.clear();
+            spawnMovingEntities(world, renderer, count);
+            runCase("physics_step", std::to_string(count), 1, [&] {
+                world.registry.clear<Collision>();
+            }, [&] {
+                physics.step(FRAME_MS);
+            });
+        }
+        world.registry.clear();
+    }
+
+    void benchBoids(World& world) {
+        BoidsSystem boids(world);
+        for (int count : { 100, 1000, 10000 }) {
+            world.registry.clear();
+            world.random.reseed(BENCH_SEED);
+            BoidsSystem::createBoidsFlock(world, nullptr, vec2(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX) * 0.5f, WINDOW_HEIGHT_PX * 0.5f, count);
+            runCase("boids_update", std::to_string(count), 1, nullptr, [&] {
+                boids.updateBoids(FRAME_MS);
+            });
+        }
+        world.registry.clear();
+    }
+
+    void benchRenderList(World& world, RenderSystem& renderer) {
+        std::vector<entt::entity> render_list;
+        for (int count : { 500, 5000 }) {
+            world.registry.clear();
+            Rng rng(BENCH_SEED);
+            for (int i = 0; i < count; i++) {
+                entt::entity entity = world.registry.create();
+                Motion& motion = world.registry.emplace<Motion>(entity);
+                motion.position = randomPosition(rng);
+                int z = (int)rng.uniform(0.f, 10.f);
+                world.registry.emplace<RenderRequest>(entity, TEXTURE_ASSET_ID::SNIPER_CAT_2, EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE, z);
+            }
+            runCase("render_list", std::to_string(count), 1, nullptr, [&] {
+                renderer.build_render_list(render_list);
+            });
+        }
+        world.registry.clear();
+    }
+
+    void benchLevels(World& world, RenderSystem& renderer) {
+        for (int level = 0; level < (int)world.map_system.levels.size(); level++) {
+            const std::string& name = std::get<0>(world.map_system.levels[level]);
+
+            runCase("load_level", name, 1, [&] {
+                world.registry.clear();
+            }, [&] {
+                world.map_system.loadLevel(level);
+                world.map_system.createLevel(world, &renderer);
+            });
+
+            // a restart: the level copied back from a snapshot of the one just loaded.
+            // Skipped, like a restart falls back to creating the level, if capture refuses
+            // it (the reason is logged); an empty restore would time nothing
+            Snapshot snapshot(world.registry);
+            trackLevelComponents(snapshot);
+            auto level_view = world.registry.view<Motion>();
+            if (snapshot.capture(std::vector<entt::entity>(level_view.begin(), level_view.end()))) {
+                runCase("restore_level", name, 1, [&] {
+                    world.registry.clear();
+                }, [&] {
+                    std::vector<entt::entity> entities;
+                    snapshot.restore(entities);
+                    world.map_system.resetLevel();
+                });
+            }
+
+            // corner to corner over the tiles the level marks walkable
+            const std::vector<std::vector<Tile>>& tile_map = world.map_system.getTileMap();
+            std::vector<ivec2> walkable;
+            for (int row = 0; row < (int)tile_map.size(); row++) {
+                for (int col = 0; col < (int)tile_map[row].size(); col++) {
+                    if (tile_map[row][col].walkable)
+                        walkable.push_back(ivec2(col, row));
+                }
+            }
+            if (walkable.size() < 2)
+                continue;
+            ivec2 start = walkable.front();
+            ivec2 goal = walkable.back();
+            runCase("a_star", name, 1, nullptr, [&] {
+                std::vector<ivec2> path;
+                FrameArenaScope arena_scope;
+                StarVisitedSet visited;
+                StarNode start_node(start.x, start.y, nullptr, 0, 0);
+                StarNode goal_node(goal.x, goal.y, nullptr, 0, 0);
+                aStar(path, visited, &start_node, &goal_node, tile_map);
+            });
+        }
+        world.registry.clear();
+    }
+
+    std::string escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    std::string toJson() {
+        std::stringstream json;
+        json << "{\n  \"seed\": " << BENCH_SEED << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            json << "    { \"name\": \"" << escape(r.name) << "\", \"param\": \"" << escape(r.param)
+                 << "\", \"iterations\": " << r.iterations
+                 << ", \"ops_per_iteration\": " << r.ops_per_iteration
+                 << ", \"mean_ns\": " << (long long)r.mean_ns
+                 << ", \"min_ns\": " << (long long)r.min_ns
+                 << ", \"ns_per_op\": " << r.mean_ns / r.ops_per_iteration << " }"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+        return json.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string out_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            name_filter = argv[++i];
+        } else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    World world(BENCH_SEED);
+
+    // meshes only, no GL
+    RenderSystem renderer(world);
+    renderer.init_headless();
+
+    benchMeshLoading();
+    benchCollides(world, renderer);
+    benchPhysics(world, renderer);
+    benchBoids(world);
+    benchRenderList(world, renderer);
+    benchLevels(world, renderer);
+
+    std::string json = toJson();
+    if (out_path.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(out_path);
+        if (!out.is_open()) {
+            std::cerr << "Could not write " << out_path << std::endl;
+            return EXIT_FAILURE;
+        }
+        out << json;
+    }
+    return EXIT_SUCCESS;
+}
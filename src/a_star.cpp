@@ -1,3 +1,4 @@
+#include <new>
 #include <optional>
 #include <unordered_set>
 #include <cmath>
@@ -7,6 +8,7 @@
 #include "tinyECS/registry.hpp"
 #include "world_init.hpp"
 #include "render_system.hpp"
+#include "util/perf_counters.hpp"
 
 
 int manhattanDistance(ivec2 a, ivec2 b) {
@@ -18,10 +20,10 @@ void processDirection(
     StarNode* curr,
     const StarNode* start,
     const StarNode* goal,
-    const std::unordered_map<ivec2, StarNode*, PairHash>& validPositions,
+    StarNode* nodes,
     const std::vector<std::vector<Tile>>& tile_map, 
-    std::unordered_set<ivec2, PairHash>& visited,
-    std::priority_queue<StarNode*, std::vector<StarNode*>, StarNodeComparator>& queue)
+    StarVisitedSet& visited,
+    StarNodeQueue& queue)
 {
     int x = direction.x;
     int y = direction.y;
@@ -38,7 +40,7 @@ void processDirection(
     if (visited.find(direction) != visited.end())
         return;
     
-    StarNode* node = validPositions.at(direction);
+    StarNode* node = &nodes[y * tile_map[0].size() + x];
 
     int gScore = manhattanDistance({start->x, start->y}, direction);
     int hScore = manhattanDistance(direction, {goal->x, goal->y});
@@ -55,15 +57,22 @@ void processDirection(
 
 
 
-void aStar(std::vector<ivec2>& path, std::unordered_set<ivec2, PairHash>& visited, StarNode* start, StarNode* goal, const std::vector<std::vector<Tile>>& tile_map) {
-    std::unordered_map<ivec2, StarNode*, PairHash> validPositions;
-    std::priority_queue<StarNode*, std::vector<StarNode*>, StarNodeComparator> queue;
+void aStar(std::vector<ivec2>& path, StarVisitedSet& visited, StarNode* start, StarNode* goal, const std::vector<std::vector<Tile>>& tile_map) {
+    size_t tile_count = tile_map.size() * tile_map[0].size();
+
+    // one node per tile, row-major, in the frame arena
+    StarNode* nodes = FrameArena::frame().allocateArray<StarNode>(tile_count);
+    visited.reserve(tile_count);
+
+    FrameVector<StarNode*> queue_storage;
+    queue_storage.reserve(tile_count);
+    StarNodeQueue queue(StarNodeComparator(), std::move(queue_storage));
     queue.emplace(start);
 
     // init valid positions
-    for (int row = 0; row < WINDOW_HEIGHT_TILES; row++) {
-        for (int col = 0; col < WINDOW_WIDTH_TILES; col++) {
-            validPositions[{col, row}] = new StarNode(
+    for (int row = 0; row < (int)tile_map.size(); row++) {
+        for (int col = 0; col < (int)tile_map[row].size(); col++) {
+            new (&nodes[row * tile_map[0].size() + col]) StarNode(
                 col,
                 row,
                 nullptr,
@@ -81,6 +90,7 @@ void aStar(std::vector<ivec2>& path, std::unordered_set<ivec2, PairHash>& visite
         if (visited.find({curr->x, curr->y}) != visited.end())
             continue;
         visited.insert({curr->x, curr->y});
+        PerfCounters::add(PerfCounter::ASTAR_NODES_EXPANDED);
 
         if (curr->x == goal->x && curr->y == goal->y) {
             StarNode* node = curr;
@@ -92,9 +102,9 @@ void aStar(std::vector<ivec2>& path, std::unordered_set<ivec2, PairHash>& visite
             return;
         }
         
-        processDirection({curr->x, curr->y - 1}, curr, start, goal, validPositions, tile_map, visited, queue);
-        processDirection({curr->x + 1, curr->y}, curr, start, goal, validPositions, tile_map, visited, queue);
-        processDirection({curr->x, curr->y + 1}, curr, start, goal, validPositions, tile_map, visited, queue);
-        processDirection({curr->x - 1, curr->y}, curr, start, goal, validPositions, tile_map, visited, queue);
+        processDirection({curr->x, curr->y - 1}, curr, start, goal, nodes, tile_map, visited, queue);
+        processDirection({curr->x + 1, curr->y}, curr, start, goal, nodes, tile_map, visited, queue);
+        processDirection({curr->x, curr->y + 1}, curr, start, goal, nodes, tile_map, visited, queue);
+        processDirection({curr->x - 1, curr->y}, curr, start, goal, nodes, tile_map, visited, queue);
     }
 }
\ No newline at end of file
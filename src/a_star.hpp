@@ -10,6 +10,7 @@
 
 #include "tinyECS/components.hpp"
 #include "render_system.hpp"
+#include "util/frame_arena.hpp"
 
 // f(n) = g(n) + h(n)
 // g(n): cost from start to this node
@@ -42,6 +43,11 @@ struct PairHash {
 };
 
 
+// search scratch is allocated from the frame arena; wrap a search in a FrameArenaScope
+// to release it straight away
+using StarVisitedSet = std::unordered_set<ivec2, PairHash, std::equal_to<ivec2>, FrameAllocator<ivec2>>;
+using StarNodeQueue = std::priority_queue<StarNode*, FrameVector<StarNode*>, StarNodeComparator>;
+
 int manhattanDistance(ivec2 a, ivec2 b);
 std::optional<StarNode> findStarNodeByTextureType(std::map<TEXTURE_ASSET_ID, bool> textures);
 void processDirection(
@@ -49,7 +55,8 @@ void processDirection(
     StarNode* curr,
     const StarNode* start,
     const StarNode* goal,
+    StarNode* nodes,
     const std::vector<std::vector<Tile>>& tile_map, 
-    std::unordered_set<ivec2, PairHash>& visited,
-    std::priority_queue<StarNode*, std::vector<StarNode*>, StarNodeComparator>& queue);
-void aStar(std::vector<ivec2>& path, std::unordered_set<ivec2, PairHash>& visited, StarNode* start, StarNode* goal, const std::vector<std::vector<Tile>>& tile_map);
\ No newline at end of file
+    StarVisitedSet& visited,
+    StarNodeQueue& queue);
+void aStar(std::vector<ivec2>& path, StarVisitedSet& visited, StarNode* start, StarNode* goal, const std::vector<std::vector<Tile>>& tile_map);
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ai_scheduler.hpp"
+
+float AIScheduler::intervalFor(entt::entity entity, bool has_player, vec2 player_pos) const {
+    if (!has_player)
+        return 0.f;
+
+    // a cat chasing or returning reacts every frame
+    if (world.registry.any_of<PatrolChasing, PatrolReturning>(entity))
+        return 0.f;
+
+    vec2 pos = world.registry.get<Motion>(entity).position;
+    float tiles_x = std::abs(player_pos.x - pos.x) / GRID_CELL_WIDTH_PX;
+    float tiles_y = std::abs(player_pos.y - pos.y) / GRID_CELL_HEIGHT_PX;
+    float tiles = std::max(tiles_x, tiles_y);
+
+    if (tiles <= AI_NEAR_TILES)
+        return 0.f;
+    if (tiles <= AI_MID_TILES)
+        return AI_MID_INTERVAL_MS;
+    return AI_FAR_INTERVAL_MS;
+}
+
+void AIScheduler::registerAgents() {
+    // every sniper and patrol cat is an agent
+    for (auto entity : world.registry.view<Sniper, Motion>()) {
+        if (!world.registry.all_of<AITick>(entity))
+            world.registry.emplace<AITick>(entity);
+    }
+    for (auto entity : world.registry.view<Patrol, Motion>()) {
+        if (!world.registry.all_of<AITick>(entity))
+            world.registry.emplace<AITick>(entity);
+    }
+}
+
+void AIScheduler::update(float elapsed_ms) {
+    bool has_player = false;
+    vec2 player_pos = {0, 0};
+    for (auto player_entity : world.registry.view<Player, Motion>()) {
+        player_pos = world.registry.get<Motion>(player_entity).position;
+        has_player = true;
+        break;
+    }
+
+    agents.clear();
+    for (auto entity : world.registry.view<AITick, Motion>()) {
+        AITick& tick = world.registry.get<AITick>(entity);
+        tick.accumulated_ms += elapsed_ms;
+        tick.interval_ms = intervalFor(entity, has_player, player_pos);
+        tick.step_ms = 0.f;
+        tick.due = false;
+        agents.push_back(entity);
+    }
+
+    due_count = 0;
+    if (agents.empty())
+        return;
+
+    // full-rate agents go first, then everyone whose interval has elapsed;
+    // both passes start at the cursor so skipped agents are first in line next frame
+    size_t count = agents.size();
+    size_t start = cursor % count;
+    size_t last_taken = start;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < count && due_count < AI_AGENTS_PER_FRAME; i++) {
+            size_t index = (start + i) % count;
+            AITick& tick = world.registry.get<AITick>(agents[index]);
+            if (tick.due || tick.accumulated_ms < tick.interval_ms)
+                continue;
+            if (pass == 0 && tick.interval_ms > 0.f)
+                continue;
+
+            tick.due = true;
+            tick.step_ms = tick.accumulated_ms;
+            tick.accumulated_ms = 0.f;
+            due_count++;
+            last_taken = index;
+        }
+    }
+    cursor = last_taken + 1;
+}
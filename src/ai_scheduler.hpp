@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+#include "world.hpp"
+
+// Time-sliced AI updates.
+// Every sniper and patrol cat gets an AITick whose interval depends on how far it is from
+// Tom and whether it is chasing. Agents whose interval has elapsed are marked due in
+// round-robin order until the per-frame budget is used up; an agent that is due integrates
+// all the time it skipped through AITick::step_ms.
+class AIScheduler {
+public:
+    explicit AIScheduler(World& world) : world(world) {}
+
+    // gives every sniper and patrol cat an AITick (adds components, so main thread only)
+    void registerAgents();
+
+    void update(float elapsed_ms);
+
+    size_t agentCount() const { return agents.size(); }
+    size_t dueCount() const { return due_count; }
+
+private:
+    float intervalFor(entt::entity entity, bool has_player, vec2 player_pos) const;
+
+    World& world;
+    std::vector<entt::entity> agents;
+    size_t cursor = 0;
+    size_t due_count = 0;
+};
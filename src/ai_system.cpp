@@ -1,15 +1,31 @@
 #include <iostream>
+#include <algorithm>
 #include "common.hpp"
 #include "ai_system.hpp"
 #include "world_init.hpp"
+#include "world.hpp"
 #include "tinyECS/registry.hpp"
 
-void AISystem::step(RenderSystem* renderer, float elapsed_ms)
+namespace {
+    const float ARRIVAL_THRESHOLD = 5.0f; // increase for smoother arrival
+    const float SNAP_THRESHOLD = 1.0f;    // if within threshold, snap to waypoint
+    const float MIN_MOVEMENT = 0.05f;     // prevents oscillation 
+
+    vec2 cell_centre(ivec2 cell) {
+        return vec2(GRID_CELL_WIDTH_PX / 2 + cell.x * GRID_CELL_WIDTH_PX,
+                    GRID_CELL_HEIGHT_PX / 2 + cell.y * GRID_CELL_HEIGHT_PX);
+    }
+}
+
+void AISystem::registerAgents()
 {
-    animateCats();
-    // Patrol AI
-    processSniperCats(renderer, elapsed_ms);
-    processPatrolCats(elapsed_ms);
+    scheduler.registerAgents();
+}
+
+// level of detail: only agents marked due are updated this frame
+void AISystem::scheduleAgents(float elapsed_ms)
+{
+    scheduler.update(elapsed_ms);
 }
 
 
@@ -17,19 +33,24 @@ void AISystem::step(RenderSystem* renderer, float elapsed_ms)
 // - for each sniper, scan its direction
 // - if Tom is detected and the tower's shooting timer has expired,
 //   create a projectile in the direction of Tom and reset timer
-void AISystem::processSniperCats(RenderSystem* renderer, float elapsed_ms) {
-    auto sniper_view = registry.view<Sniper>();
+void AISystem::processSniperCats(RenderSystem* renderer) {
+    auto sniper_view = world.registry.view<Sniper, AITick>();
     for (auto sniper_entity : sniper_view) {
-        Sniper& sniper = registry.get<Sniper>(sniper_entity);
-        vec2 sniper_pos = registry.get<Motion>(sniper_entity).position;
-        sniper.timer_ms -= elapsed_ms;
+        AITick& tick = world.registry.get<AITick>(sniper_entity);
+        if (!tick.due) {
+            continue;
+        }
+
+        Sniper& sniper = world.registry.get<Sniper>(sniper_entity);
+        vec2 sniper_pos = world.registry.get<Motion>(sniper_entity).position;
+        sniper.timer_ms -= tick.step_ms;
 
         // skip shooting if still reloading
         if (sniper.timer_ms > 0) {
             continue;
         }
 
-        auto player_view = registry.view<Player>();
+        auto player_view = world.registry.view<Player>();
         for (auto player_entity : player_view) {
             if (is_tom_visible_to_sniper(sniper_entity, player_entity)) {
                 vec2 bullet_position;
@@ -55,7 +76,7 @@ void AISystem::processSniperCats(RenderSystem* renderer, float elapsed_ms) {
                         break;
                 }
 
-                createSniperBullet(renderer, bullet_position, SNIPER_BULLET_SIZE, bullet_velocity, HARMFUL_DAMAGE);
+                createSniperBullet(world, renderer, bullet_position, SNIPER_BULLET_SIZE, bullet_velocity, HARMFUL_DAMAGE);
                 sniper.timer_ms = SNIPER_TIMER_MS;
                 break;
             }
@@ -65,14 +86,14 @@ void AISystem::processSniperCats(RenderSystem* renderer, float elapsed_ms) {
 
 // check if Tom is visible to the sniper cat based on the sniper cat's direction and if there are walls between them
 bool AISystem::is_tom_visible_to_sniper(entt::entity sniper_entity, entt::entity player_entity) {
-    Sniper& sniper = registry.get<Sniper>(sniper_entity);
+    Sniper& sniper = world.registry.get<Sniper>(sniper_entity);
     Direction direction = sniper.direction;
 
-    vec2 sniper_pos = registry.get<Motion>(sniper_entity).position;
+    vec2 sniper_pos = world.registry.get<Motion>(sniper_entity).position;
     int sniper_tile_x = (int)(sniper_pos.x / GRID_CELL_WIDTH_PX);
     int sniper_tile_y = (int)(sniper_pos.y / GRID_CELL_HEIGHT_PX);
 
-    vec2 player_pos = registry.get<Motion>(player_entity).position;
+    vec2 player_pos = world.registry.get<Motion>(player_entity).position;
     int player_tile_x = (int)(player_pos.x / GRID_CELL_WIDTH_PX);
     int player_tile_y = (int)(player_pos.y / GRID_CELL_HEIGHT_PX);
 
@@ -108,8 +129,8 @@ bool AISystem::is_tom_visible_to_sniper(entt::entity sniper_entity, entt::entity
     }
 
     // check if there are any walls that block sniper's view of Tom
-    for (const entt::entity &wall_entity : registry.view<Wall>()) {
-        Motion& wall_motion = registry.get<Motion>(wall_entity);
+    for (const entt::entity &wall_entity : world.registry.view<Wall>()) {
+        Motion& wall_motion = world.registry.get<Motion>(wall_entity);
         int wall_tile_x = (int)(wall_motion.position.x / GRID_CELL_WIDTH_PX);
         int wall_tile_y = (int)(wall_motion.position.y / GRID_CELL_HEIGHT_PX);
         if (is_blocking_view(wall_tile_x, wall_tile_y, sniper_tile_x, sniper_tile_y, player_tile_x, player_tile_y, direction)) {
@@ -118,13 +139,13 @@ bool AISystem::is_tom_visible_to_sniper(entt::entity sniper_entity, entt::entity
     }
 
     // check if there are any locked doors that block sniper's view of Tom
-    for (const entt::entity &door_entity : registry.view<Door>()) {
-        Door &door = registry.get<Door>(door_entity);
+    for (const entt::entity &door_entity : world.registry.view<Door>()) {
+        Door &door = world.registry.get<Door>(door_entity);
         if (!door.locked) {
             continue;
         }
 
-        Motion& door_motion = registry.get<Motion>(door_entity);
+        Motion& door_motion = world.registry.get<Motion>(door_entity);
         int door_tile_x = (int)(door_motion.position.x / GRID_CELL_WIDTH_PX);
         int door_tile_y = (int)(door_motion.position.y / GRID_CELL_HEIGHT_PX);
         if (is_blocking_view(door_tile_x, door_tile_y, sniper_tile_x, sniper_tile_y, player_tile_x, player_tile_y, direction)) {
@@ -150,120 +171,219 @@ bool AISystem::is_blocking_view(int block_tile_x, int block_tile_y, int sniper_t
 
 
 // patrol cat AI
-void AISystem::processPatrolCats(float elapsed_ms) {
-    auto patrol_view = registry.view<Patrol, Motion>();
-    auto player_view = registry.view<Player, Motion>();
-
+// Each state runs as its own batch over only the cats in that state. State changes are
+// collected while the batches run and applied afterwards by applyPatrolTransitions, so a
+// cat is handled by exactly one batch per frame and the batches never add or remove
+// components.
+void AISystem::processPatrolCats() {
+    auto patrol_view = world.registry.view<Patrol, Motion>();
+    auto player_view = world.registry.view<Player, Motion>();
+
+    patrol_transitions.clear();
     if (player_view.begin() == player_view.end()) {
         // Freeze all patrols if no players are present
         for (auto patrol_entity : patrol_view) {
-            registry.get<Motion>(patrol_entity).velocity = {0, 0};
+            world.registry.get<Motion>(patrol_entity).velocity = {0, 0};
         }
         return;
     }
 
-    for (auto entity : patrol_view) {
-        Patrol& patrol = registry.get<Patrol>(entity);
-        Motion& motion = registry.get<Motion>(entity);
+    processWalkingPatrols();
+    processChasingPatrols();
+    processReturningPatrols();
+}
 
+// normal patrol movement back and forth along the waypoints
+void AISystem::processWalkingPatrols() {
+    auto walking_view = world.registry.view<PatrolWalking, Patrol, Motion, AITick>();
+    for (auto entity : walking_view) {
+        AITick& tick = walking_view.get<AITick>(entity);
+        if (!tick.due) continue;
+
+        Patrol& patrol = walking_view.get<Patrol>(entity);
+        Motion& motion = walking_view.get<Motion>(entity);
         if (patrol.waypoints.empty()) continue;
 
         vec2 player_pos;
-        bool player_nearby = false;
-
-        // Check for nearby players
-        for (auto player_entity : player_view) {
-            Motion& player_motion = registry.get<Motion>(player_entity);
-            player_pos = player_motion.position;
-
-            float grid_distance_x = abs(player_pos.x - motion.position.x) / GRID_CELL_WIDTH_PX;
-            float grid_distance_y = abs(player_pos.y - motion.position.y) / GRID_CELL_HEIGHT_PX;
+        if (find_visible_player(motion.position, player_pos)) {
+            // first time detecting player so store last patrol position
+            patrol.lastPatrolPos = motion.position;
+            patrol.lastTargetIndex = patrol.currentTargetIndex;
+            patrol_transitions.push_back({entity, PatrolState::CHASING});
 
-            if (grid_distance_x <= PATROL_RANGE && grid_distance_y <= PATROL_RANGE && !is_blocked(motion.position, player_pos)) {
-                player_nearby = true;
-                break;
-            }
+            move_patrol(motion, player_pos - motion.position, tick.step_ms);
+            continue;
         }
 
-        vec2 direction = {0, 0};
-        const float ARRIVAL_THRESHOLD = 5.0f; // increase for smoother arrival
-        const float SNAP_THRESHOLD = 1.0f;    // if within threshold, snap to waypoint
-        const float MIN_MOVEMENT = 0.05f;     // prevents oscillation 
+        // a cat that was skipped kept moving (physics and this step both move it), so widen
+        // the arrival check by the distance it covered since its last update
+        float patrol_arrival = std::max(ARRIVAL_THRESHOLD, 2.f * PATROL_SPEED * (tick.step_ms / 1000.f));
 
-        if (player_nearby) { 
-            // first time detecting player so store last patrol position
-            if (!patrol.chasing) {
-                patrol.lastPatrolPos = motion.position;
-                patrol.lastTargetIndex = patrol.currentTargetIndex;
-                patrol.chasing = true;
-            }
+        vec2 target_pos = patrol.waypoints[patrol.currentTargetIndex];
+        vec2 patrol_direction = target_pos - motion.position;
 
-            // chase player
-            vec2 chase_direction = player_pos - motion.position;
-            if (length(chase_direction) > MIN_MOVEMENT) {
-                direction = normalize(chase_direction);
-            }
-        } 
-        else if (patrol.chasing) {
-            // return to last patrol position
-            vec2 return_direction = patrol.waypoints[patrol.lastTargetIndex] - motion.position;
-
-            if (length(return_direction) > ARRIVAL_THRESHOLD) {
-                direction = normalize(return_direction);
-            } 
-            else {
-                // snap to waypoint and resume normal patrol
-                motion.position = patrol.waypoints[patrol.lastTargetIndex];
-                patrol.currentTargetIndex = patrol.lastTargetIndex;
-                patrol.chasing = false;
-            }
-        } 
-        else {
-            // normal patrol movement
-            vec2 target_pos = patrol.waypoints[patrol.currentTargetIndex];
-            vec2 patrol_direction = target_pos - motion.position;
-
-            if (length(patrol_direction) > MIN_MOVEMENT) {
-                direction = normalize(patrol_direction);
+        if (length(target_pos - motion.position) < patrol_arrival) {
+            if (length(target_pos - motion.position) < SNAP_THRESHOLD) {
+                // snap to avoid overshooting or stalling
+                motion.position = target_pos;
             }
 
-            if (length(target_pos - motion.position) < ARRIVAL_THRESHOLD) {
-                if (length(target_pos - motion.position) < SNAP_THRESHOLD) {
-                    // snap to avoid overshooting or stalling
-                    motion.position = target_pos;
+            // move to next waypoint (reverse if at end of waypoints)
+            if (!patrol.reversing) {
+                if (patrol.currentTargetIndex < patrol.waypoints.size() - 1) {
+                    patrol.currentTargetIndex++;
+                } else {
+                    patrol.reversing = true;
+                    patrol.currentTargetIndex--;
                 }
-
-                // move to next waypoint (reverse if at end of waypoints)
-                if (!patrol.reversing) {
-                    if (patrol.currentTargetIndex < patrol.waypoints.size() - 1) {
-                        patrol.currentTargetIndex++;
-                    } else {
-                        patrol.reversing = true;
-                        patrol.currentTargetIndex--;
-                    }
+            } else {
+                if (patrol.currentTargetIndex > 0) {
+                    patrol.currentTargetIndex--;
                 } else {
-                    if (patrol.currentTargetIndex > 0) {
-                        patrol.currentTargetIndex--;
-                    } else {
-                        patrol.reversing = false;
-                        patrol.currentTargetIndex++;
-                    }
+                    patrol.reversing = false;
+                    patrol.currentTargetIndex++;
                 }
             }
         }
 
-        // no small movement oscillations
-        if (length(direction) > MIN_MOVEMENT) {
-            motion.velocity = direction * PATROL_SPEED;
-            motion.position += motion.velocity * (elapsed_ms / 1000.f);
+        move_patrol(motion, patrol_direction, tick.step_ms);
+    }
+}
+
+// chase Tom while he is in range and visible
+void AISystem::processChasingPatrols() {
+    auto chasing_view = world.registry.view<PatrolChasing, Patrol, Motion, AITick>();
+    for (auto entity : chasing_view) {
+        AITick& tick = chasing_view.get<AITick>(entity);
+        if (!tick.due) continue;
+
+        Patrol& patrol = chasing_view.get<Patrol>(entity);
+        Motion& motion = chasing_view.get<Motion>(entity);
+
+        vec2 player_pos;
+        if (find_visible_player(motion.position, player_pos)) {
+            move_patrol(motion, player_pos - motion.position, tick.step_ms);
+            continue;
+        }
+
+        // lost Tom, head back to where the patrol was left
+        patrol_transitions.push_back({entity, PatrolState::RETURNING});
+        plan_return(patrol, motion.position);
+        vec2 target_pos = patrol.returnPath.empty() ? patrol.waypoints[patrol.lastTargetIndex] : cell_centre(patrol.returnPath.back().cell);
+        move_patrol(motion, target_pos - motion.position, tick.step_ms);
+    }
+}
+
+// return to last patrol position, unless Tom shows up again
+void AISystem::processReturningPatrols() {
+    auto returning_view = world.registry.view<PatrolReturning, Patrol, Motion, AITick>();
+    for (auto entity : returning_view) {
+        AITick& tick = returning_view.get<AITick>(entity);
+        if (!tick.due) continue;
+
+        Patrol& patrol = returning_view.get<Patrol>(entity);
+        Motion& motion = returning_view.get<Motion>(entity);
+
+        vec2 player_pos;
+        if (find_visible_player(motion.position, player_pos)) {
+            patrol_transitions.push_back({entity, PatrolState::CHASING});
+            move_patrol(motion, player_pos - motion.position, tick.step_ms);
+            continue;
+        }
+
+        // portals placed or removed since planning may change the best route or remove a
+        // teleport the plan relies on
+        if (patrol.returnPortalVersion != world.map_system.getPortalVersion()) {
+            plan_return(patrol, motion.position);
+        }
+
+        // follow the planned cells, jumping through portals where the route does, then
+        // close in on the waypoint itself
+        float patrol_arrival = std::max(ARRIVAL_THRESHOLD, 2.f * PATROL_SPEED * (tick.step_ms / 1000.f));
+        while (!patrol.returnPath.empty()) {
+            const PathStep& step = patrol.returnPath.back();
+            if (step.teleport) {
+                // standing at the entry portal, come out at the exit
+                motion.position = cell_centre(step.cell);
+            } else if (length(cell_centre(step.cell) - motion.position) >= patrol_arrival) {
+                break;
+            }
+            patrol.returnPath.pop_back();
+        }
+
+        vec2 target_pos = patrol.returnPath.empty() ? patrol.waypoints[patrol.lastTargetIndex] : cell_centre(patrol.returnPath.back().cell);
+        vec2 return_direction = target_pos - motion.position;
+        if (!patrol.returnPath.empty() || length(return_direction) > ARRIVAL_THRESHOLD) {
+            move_patrol(motion, return_direction, tick.step_ms);
         } else {
-            motion.velocity = {0, 0}; // stop jittering
+            // snap to waypoint and resume normal patrol
+            motion.position = patrol.waypoints[patrol.lastTargetIndex];
+            patrol.currentTargetIndex = patrol.lastTargetIndex;
+            patrol_transitions.push_back({entity, PatrolState::WALKING});
+            move_patrol(motion, {0, 0}, tick.step_ms);
         }
     }
 }
 
+void AISystem::applyPatrolTransitions() {
+    for (const auto& [entity, state] : patrol_transitions) {
+        world.registry.remove<PatrolWalking, PatrolChasing, PatrolReturning>(entity);
+        switch (state) {
+            case PatrolState::WALKING:
+                world.registry.emplace<PatrolWalking>(entity);
+                break;
+            case PatrolState::CHASING:
+                world.registry.emplace<PatrolChasing>(entity);
+                break;
+            case PatrolState::RETURNING:
+                world.registry.emplace<PatrolReturning>(entity);
+                break;
+        }
+    }
+}
+
+// route back to the waypoint the patrol left, around walls instead of straight at it and
+// through portals when that is shorter. Chases tend to end in the same few cells, so the
+// walking part mostly comes from the path cache.
+// Leaves returnPath empty (steer straight) if there is no route.
+void AISystem::plan_return(Patrol& patrol, vec2 patrol_pos) {
+    vec2 waypoint = patrol.waypoints[patrol.lastTargetIndex];
+    ivec2 start((int)(patrol_pos.x / GRID_CELL_WIDTH_PX), (int)(patrol_pos.y / GRID_CELL_HEIGHT_PX));
+    ivec2 goal((int)(waypoint.x / GRID_CELL_WIDTH_PX), (int)(waypoint.y / GRID_CELL_HEIGHT_PX));
+
+    // goal first, so the next cell to head for is always at the back
+    patrol.returnPath = world.map_system.findRoute(start, goal);
+    patrol.returnPortalVersion = world.map_system.getPortalVersion();
+}
+
+// true if a player is within patrol range and not hidden behind a wall
+bool AISystem::find_visible_player(vec2 patrol_pos, vec2& player_pos) {
+    auto player_view = world.registry.view<Player, Motion>();
+    for (auto player_entity : player_view) {
+        player_pos = player_view.get<Motion>(player_entity).position;
+
+        float grid_distance_x = abs(player_pos.x - patrol_pos.x) / GRID_CELL_WIDTH_PX;
+        float grid_distance_y = abs(player_pos.y - patrol_pos.y) / GRID_CELL_HEIGHT_PX;
+
+        if (grid_distance_x <= PATROL_RANGE && grid_distance_y <= PATROL_RANGE && !is_blocked(patrol_pos, player_pos)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AISystem::move_patrol(Motion& motion, vec2 offset, float step_ms) {
+    // no small movement oscillations
+    if (length(offset) > MIN_MOVEMENT) {
+        motion.velocity = normalize(offset) * PATROL_SPEED;
+        motion.position += motion.velocity * (step_ms / 1000.f);
+    } else {
+        motion.velocity = {0, 0}; // stop jittering
+    }
+}
+
 bool AISystem::is_blocked(vec2 start, vec2 end) {
-    auto wall_view = registry.view<Wall, Motion>();
+    auto wall_view = world.registry.view<Wall, Motion>();
 
     // Define the number of steps for the raycast
     int steps = 10;  
@@ -274,7 +394,7 @@ bool AISystem::is_blocked(vec2 start, vec2 end) {
         vec2 check_pos = start + step_vector * float(i);
 
         for (auto wall_entity : wall_view) {
-            Motion& wall_motion = registry.get<Motion>(wall_entity);
+            Motion& wall_motion = world.registry.get<Motion>(wall_entity);
             vec2 wall_pos = wall_motion.position;
             vec2 wall_size = wall_motion.scale;
 
@@ -292,10 +412,10 @@ bool AISystem::is_blocked(vec2 start, vec2 end) {
 }
 
 void AISystem::animateCats() {
-    auto animated_cats = registry.view<Cat, Animation, Motion>();
+    auto animated_cats = world.registry.view<Cat, Animation, Motion>();
     for (auto entity : animated_cats) {
-        Motion& motion = registry.get<Motion>(entity);
-        Animation& animation = registry.get<Animation>(entity);
+        Motion& motion = world.registry.get<Motion>(entity);
+        Animation& animation = world.registry.get<Animation>(entity);
 
         vec2 velocity = motion.velocity;
         float angle = atan2(velocity.y, velocity.x);
@@ -1,20 +1,47 @@
 #pragma once
 
+#include <vector>
+#include <utility>
+
 #include "common.hpp"
 #include "render_system.hpp"
+#include "ai_scheduler.hpp"
 
+// The AI runs as separate steps so the system scheduler can order them by what they touch
+// (see main.cpp): registerAgents, then animateCats and scheduleAgents, processSniperCats,
+// processPatrolCats and finally applyPatrolTransitions.
 class AISystem
 {
     public:
-        void step(RenderSystem* renderer, float elapsed_ms);
+        explicit AISystem(World& world) : world(world), scheduler(world) {}
+
+        void registerAgents();
+        void scheduleAgents(float elapsed_ms);
+        void animateCats();
+        void processSniperCats(RenderSystem* renderer);
+        void processPatrolCats();
+        void applyPatrolTransitions();
 
     private:
+        World& world;
+
+        // decides which agents run this frame
+        AIScheduler scheduler;
+
         // sniper cats
-        void processSniperCats(RenderSystem* renderer, float elapsed_ms);
         bool is_tom_visible_to_sniper(entt::entity sniper_entity, entt::entity player_entity);
         bool is_blocking_view(int block_tile_x, int block_tile_y, int sniper_tile_x, int sniper_tile_y, int player_tile_x, int player_tile_y, Direction direction);
         // patrol cats
-        void processPatrolCats(float elapsed_ms);
+        enum class PatrolState { WALKING, CHASING, RETURNING };
+
+        void processWalkingPatrols();
+        void processChasingPatrols();
+        void processReturningPatrols();
+        bool find_visible_player(vec2 patrol_pos, vec2& player_pos);
+        void plan_return(Patrol& patrol, vec2 patrol_pos);
+        void move_patrol(Motion& motion, vec2 offset, float step_ms);
         bool is_blocked(vec2 start, vec2 end);
-        void animateCats();
+
+        // state changes requested by this frame's batches
+        std::vector<std::pair<entt::entity, PatrolState>> patrol_transitions;
 };
\ No newline at end of file
@@ -1,37 +1,51 @@
 #include "boids_system.hpp"
 #include "world_init.hpp"
-#include <random>
+#include "world.hpp"
+#include "util/perf_counters.hpp"
+#include "util/profiler.hpp"
+#include "util/job_system.hpp"
+#include "util/rng.hpp"
 #include <cmath>
+#include <algorithm>
 
-BoidsSystem::BoidsSystem() {
+// SSE2 is part of every x86-64 target; other targets use the scalar loop
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOIDS_USE_SSE
+#include <emmintrin.h>
+#endif
+
+BoidsSystem::BoidsSystem(World& world) : world(world) {
 }
 
-entt::entity BoidsSystem::createBoid(RenderSystem* renderer, vec2 position) {
+entt::entity BoidsSystem::createBoid(World& world, RenderSystem* renderer, vec2 position) {
     // Create a new entity
-    auto entity = registry.create();
+    auto entity = world.registry.create();
     
-    registry.emplace<Boid>(entity);
+    world.registry.emplace<Boid>(entity);
 
-    Harmful& harmful = registry.emplace<Harmful>(entity);
+    Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = HARMFUL_DAMAGE;
 
-	registry.emplace<Cat>(entity);
+	world.registry.emplace<Cat>(entity);
     
-    Motion& motion = registry.emplace<Motion>(entity);
+    Motion& motion = world.registry.emplace<Motion>(entity);
     motion.position = position;
     motion.angle = 0.0f;
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
-    motion.velocity = vec2(dis(gen), dis(gen)) * 50.0f;
+    // draw x before y; argument evaluation order is unspecified
+    Rng& rng = world.random.stream(RngStream::BOIDS_SPAWN);
+    float vx = rng.uniform(-1.0f, 1.0f);
+    float vy = rng.uniform(-1.0f, 1.0f);
+    motion.velocity = vec2(vx, vy) * 50.0f;
     
     motion.scale = vec2(40.0f, 40.0f);
     
-    Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+    if (renderer) {
+        Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
+        world.registry.emplace<MeshPtr>(entity, &mesh);
+    }
     
-    registry.emplace<RenderRequest>(
+    world.registry.emplace<RenderRequest>(
         entity,
         TEXTURE_ASSET_ID::SNIPER_CAT_2,
         EFFECT_ASSET_ID::TEXTURED,
@@ -42,241 +56,407 @@ entt::entity BoidsSystem::createBoid(RenderSystem* renderer, vec2 position) {
     return entity;
 }
 
-void BoidsSystem::createBoidsFlock(RenderSystem* renderer, vec2 center, float radius, int count) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> disRadius(0.0f, radius);
-    std::uniform_real_distribution<float> disAngle(0.0f, 2.0f * M_PI);
+void BoidsSystem::createBoidsFlock(World& world, RenderSystem* renderer, vec2 center, float radius, int count) {
+    Rng& rng = world.random.stream(RngStream::BOIDS_SPAWN);
     
     for (int i = 0; i < count; i++) {
-        float angle = disAngle(gen);
-        float r = disRadius(gen);
+        float angle = rng.uniform(0.0f, 2.0f * M_PI);
+        float r = rng.uniform(0.0f, radius);
         vec2 position = center + vec2(cos(angle) * r, sin(angle) * r);
-        createBoid(renderer, position);
+        createBoid(world, renderer, position);
     }
 }
 
-void BoidsSystem::updateBoids(float elapsed_ms) {
-    float deltaTime = elapsed_ms / 1000.0f;
-    
-    // Get all boids
-    auto view = registry.view<Boid, Motion>();
-    
-    // Store all valid boid entities for neighbor calculations
-    std::vector<entt::entity> allBoids;
-    for (auto entity : view) {
-        allBoids.push_back(entity);
+namespace {
+    // keep the grid at a few cells per boid when the flock is spread out
+    const int MAX_CELLS_PER_BOID = 4;
+
+    // boids per parallelFor chunk on the job system
+    const int BOID_UPDATE_CHUNK = 256;
+
+    // extra SoA slots after the last boid
+    const int SIMD_PADDING = 3;
+
+#ifdef BOIDS_USE_SSE
+    float horizontalSum(__m128 v) {
+        __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        __m128 total = _mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 0x55));
+        return _mm_cvtss_f32(total);
     }
-    
-    // Update each boid
+#endif
+}
+
+void BoidsSystem::buildGrid() {
+    auto view = world.registry.view<Boid, Motion>();
+
+    grid.view_motions.clear();
+    grid.view_boids.clear();
+    vec2 min_pos = {0, 0};
+    vec2 max_pos = {0, 0};
     for (auto entity : view) {
-        // Get neighbors for this boid
-        std::vector<entt::entity> neighbors = getNeighbors(entity, BOID_NEIGHBOR_RADIUS);
-        
-        // Calculate steering forces from flocking behaviors
-        vec2 sep = separation(entity, neighbors) * BOID_SEPARATION_WEIGHT;
-        vec2 ali = alignment(entity, neighbors) * BOID_ALIGNMENT_WEIGHT;
-        vec2 coh = cohesion(entity, neighbors) * BOID_COHESION_WEIGHT;
-        vec2 wan = wander(entity) * BOID_WANDER_WEIGHT;
-        
-        // Apply all forces to the boid's acceleration
         Motion& motion = view.get<Motion>(entity);
-        vec2 acceleration = sep + ali + coh + wan;
-        
-        // Update velocity
-        motion.velocity += acceleration;
-        motion.velocity = limit(motion.velocity, BOID_MAX_SPEED);
-        
-        // Update position
-        motion.position += motion.velocity * deltaTime;
-        
-        // Update rotation (point in the direction of movement)
-        if (length(motion.velocity) > 0.001f) {
-            motion.angle = atan2(motion.velocity.y, motion.velocity.x) * (180.0f / M_PI);
-        }
-        
-        // Wrap around screen edges
-        // Wrap around screen edges (safer version)
-        if (motion.position.x < 0) {
-            motion.position.x += WINDOW_WIDTH_PX;
-        }
-        if (motion.position.x > WINDOW_WIDTH_PX) {
-            motion.position.x -= WINDOW_WIDTH_PX;
-        }
-        if (motion.position.y < 0) {
-            motion.position.y += WINDOW_HEIGHT_PX;
-        }
-        if (motion.position.y > WINDOW_HEIGHT_PX) {
-            motion.position.y -= WINDOW_HEIGHT_PX;
+        if (grid.view_motions.empty()) {
+            min_pos = motion.position;
+            max_pos = motion.position;
+        } else {
+            min_pos = vec2(std::min(min_pos.x, motion.position.x), std::min(min_pos.y, motion.position.y));
+            max_pos = vec2(std::max(max_pos.x, motion.position.x), std::max(max_pos.y, motion.position.y));
         }
+        grid.view_motions.push_back(&motion);
+        grid.view_boids.push_back(&view.get<Boid>(entity));
+    }
 
-        // Ensure position is within bounds
-        if (motion.position.x < padding) {
-            motion.position.x = padding;
-            motion.velocity.x = std::abs(motion.velocity.x) * 0.5f; // Bounce with reduced velocity
-        } else if (motion.position.x > WINDOW_WIDTH_PX - padding) {
-            motion.position.x = WINDOW_WIDTH_PX - padding;
-            motion.velocity.x = -std::abs(motion.velocity.x) * 0.5f; // Bounce with reduced velocity
-        }
+    int count = (int)grid.view_motions.size();
 
-        if (motion.position.y < padding) {
-            motion.position.y = padding;
-            motion.velocity.y = std::abs(motion.velocity.y) * 0.5f; // Bounce with reduced velocity
-        } else if (motion.position.y > WINDOW_HEIGHT_PX - padding) {
-            motion.position.y = WINDOW_HEIGHT_PX - padding;
-            motion.velocity.y = -std::abs(motion.velocity.y) * 0.5f; // Bounce with reduced velocity
-        }
+    // cells are at least the neighbour radius, so the 3x3 block around a boid covers it
+    vec2 extent = max_pos - min_pos;
+    float max_cells = (float)std::max(1, count * MAX_CELLS_PER_BOID);
+    grid.cell_size = std::max(BOID_NEIGHBOR_RADIUS, std::sqrt((extent.x + 1.f) * (extent.y + 1.f) / max_cells));
+    grid.origin = min_pos;
+    grid.cols = (int)(extent.x / grid.cell_size) + 1;
+    grid.rows = (int)(extent.y / grid.cell_size) + 1;
+
+    // counting sort by cell
+    int cell_count = grid.cols * grid.rows;
+    grid.cell_start.assign(cell_count + 1, 0);
+    grid.view_cells.resize(count);
+    for (int i = 0; i < count; i++) {
+        vec2 offset = grid.view_motions[i]->position - grid.origin;
+        int col = std::min((int)(offset.x / grid.cell_size), grid.cols - 1);
+        int row = std::min((int)(offset.y / grid.cell_size), grid.rows - 1);
+        grid.view_cells[i] = row * grid.cols + col;
+        grid.cell_start[grid.view_cells[i] + 1]++;
+    }
+    for (int cell = 0; cell < cell_count; cell++) {
+        grid.cell_start[cell + 1] += grid.cell_start[cell];
     }
-}
 
-vec2 BoidsSystem::separation(entt::entity entity, const std::vector<entt::entity>& neighbors) {
-    const Motion& motion = registry.get<Motion>(entity);
-    vec2 steer(0, 0);
-    int count = 0;
-    
-    for (auto neighbor : neighbors) {
-        if (neighbor == entity) continue;
-        
-        const Motion& neighborMotion = registry.get<Motion>(neighbor);
-        vec2 diff = motion.position - neighborMotion.position;
-        float distance = length(diff);
-        
-        if (distance < BOID_SEPARATION_RADIUS && distance > 0) {
-            // Weight by distance (closer neighbors have more influence)
-            vec2 normalizedDiff = normalize(diff);
-            steer += normalizedDiff / distance;
-            count++;
-        }
+    grid.motions.resize(count);
+    grid.boids.resize(count);
+    // padded by SIMD_PADDING so the vector kernel can always load four lanes
+    grid.pos_x.resize(count + SIMD_PADDING);
+    grid.pos_y.resize(count + SIMD_PADDING);
+    grid.vel_x.resize(count + SIMD_PADDING);
+    grid.vel_y.resize(count + SIMD_PADDING);
+    grid.cells.resize(count);
+
+    grid.cell_fill.assign(grid.cell_start.begin(), grid.cell_start.end() - 1);
+    for (int i = 0; i < count; i++) {
+        int cell = grid.view_cells[i];
+        int slot = grid.cell_fill[cell]++;
+        grid.motions[slot] = grid.view_motions[i];
+        grid.boids[slot] = grid.view_boids[i];
+        grid.pos_x[slot] = grid.view_motions[i]->position.x;
+        grid.pos_y[slot] = grid.view_motions[i]->position.y;
+        grid.vel_x[slot] = grid.view_motions[i]->velocity.x;
+        grid.vel_y[slot] = grid.view_motions[i]->velocity.y;
+        grid.cells[slot] = cell;
     }
+}
+
+void BoidsSystem::updateBoids(float elapsed_ms) {
+    PROFILE_SCOPE("boids");
+    float deltaTime = elapsed_ms / 1000.0f;
     
-    if (count > 0) {
-        steer = steer / static_cast<float>(count);
+    // read side: snapshot of the previous frame, binned into the grid
+    buildGrid();
+
+    int count = (int)grid.motions.size();
+    grid.next_positions.resize(count);
+    grid.next_velocities.resize(count);
+    grid.next_angles.resize(count);
+    grid.wander_jitter.resize(count);
+    grid.neighbor_checks.resize(count);
+
+    // random numbers are drawn up front, in order, so the result does not depend on threads
+    Rng& rng = world.random.stream(RngStream::BOIDS_WANDER);
+    for (int i = 0; i < count; i++) {
+        grid.wander_jitter[i] = rng.uniform(-0.3f, 0.3f);
     }
     
-    if (length(steer) > 0) {
-        steer = normalize(steer) * BOID_MAX_SPEED;
-        steer = steer - motion.velocity;
-        steer = limit(steer, BOID_MAX_FORCE);
+    // write side: each worker fills the next-state slots of its own boids
+    JobSystem::shared().parallelFor(count, BOID_UPDATE_CHUNK, [this, deltaTime](int begin, int end) {
+        PROFILE_SCOPE("boids_chunk");
+        for (int i = begin; i < end; i++) {
+            integrateBoid(i, deltaTime);
+        }
+    });
+
+    // swap in the new state
+    stats.boids = count;
+    stats.grid_cells = grid.cols * grid.rows;
+    stats.neighbor_checks = 0;
+    for (int i = 0; i < count; i++) {
+        Motion& motion = *grid.motions[i];
+        motion.position = grid.next_positions[i];
+        motion.velocity = grid.next_velocities[i];
+        motion.angle = grid.next_angles[i];
+        stats.neighbor_checks += grid.neighbor_checks[i];
     }
-    
-    return steer;
+    PerfCounters::add(PerfCounter::BOID_NEIGHBOR_CHECKS, stats.neighbor_checks);
 }
 
-vec2 BoidsSystem::alignment(entt::entity entity, const std::vector<entt::entity>& neighbors) {
-    const Motion& motion = registry.get<Motion>(entity);
-    vec2 sum(0, 0);
-    int count = 0;
+void BoidsSystem::integrateBoid(int boid, float deltaTime) {
+    // Calculate steering forces from flocking behaviors
+    vec2 flock = flockingForce(boid);
+    vec2 velocity = vec2(grid.vel_x[boid], grid.vel_y[boid]);
+    vec2 position = vec2(grid.pos_x[boid], grid.pos_y[boid]);
+    vec2 wan = wander(*grid.boids[boid], velocity, grid.wander_jitter[boid]) * BOID_WANDER_WEIGHT;
     
-    for (auto neighbor : neighbors) {
-        if (neighbor == entity) continue;
-        
-        const Motion& neighborMotion = registry.get<Motion>(neighbor);
-        sum += neighborMotion.velocity;
-        count++;
-    }
+    vec2 avoid = wallAvoidance(position, velocity);
     
-    if (count > 0) {
-        sum = sum / static_cast<float>(count);
-        sum = normalize(sum) * BOID_MAX_SPEED;
-        
-        vec2 steer = sum - motion.velocity;
-        return limit(steer, BOID_MAX_FORCE);
+    // Apply all forces to the boid's acceleration
+    vec2 acceleration = flock + wan + avoid;
+    float angle = grid.motions[boid]->angle;
+    
+    // Update velocity
+    velocity += acceleration;
+    velocity = limit(velocity, BOID_MAX_SPEED);
+    
+    // Update position
+    position += velocity * deltaTime;
+    
+    // Update rotation (point in the direction of movement)
+    if (dot(velocity, velocity) > 0.001f * 0.001f) {
+        angle = atan2(velocity.y, velocity.x) * (180.0f / M_PI);
     }
     
-    return vec2(0, 0);
+    // Wrap around screen edges
+    // Wrap around screen edges (safer version)
+    if (position.x < 0) {
+        position.x += WINDOW_WIDTH_PX;
+    }
+    if (position.x > WINDOW_WIDTH_PX) {
+        position.x -= WINDOW_WIDTH_PX;
+    }
+    if (position.y < 0) {
+        position.y += WINDOW_HEIGHT_PX;
+    }
+    if (position.y > WINDOW_HEIGHT_PX) {
+        position.y -= WINDOW_HEIGHT_PX;
+    }
+
+    // Ensure position is within bounds
+    if (position.x < padding) {
+        position.x = padding;
+        velocity.x = std::abs(velocity.x) * 0.5f; // Bounce with reduced velocity
+    } else if (position.x > WINDOW_WIDTH_PX - padding) {
+        position.x = WINDOW_WIDTH_PX - padding;
+        velocity.x = -std::abs(velocity.x) * 0.5f; // Bounce with reduced velocity
+    }
+
+    if (position.y < padding) {
+        position.y = padding;
+        velocity.y = std::abs(velocity.y) * 0.5f; // Bounce with reduced velocity
+    } else if (position.y > WINDOW_HEIGHT_PX - padding) {
+        position.y = WINDOW_HEIGHT_PX - padding;
+        velocity.y = -std::abs(velocity.y) * 0.5f; // Bounce with reduced velocity
+    }
+
+    grid.next_positions[boid] = position;
+    grid.next_velocities[boid] = velocity;
+    grid.next_angles[boid] = angle;
 }
 
-vec2 BoidsSystem::cohesion(entt::entity entity, const std::vector<entt::entity>& neighbors) {
-    const Motion& motion = registry.get<Motion>(entity);
-    vec2 sum(0, 0);
-    int count = 0;
-    
-    for (auto neighbor : neighbors) {
-        if (neighbor == entity) continue;
-        
-        const Motion& neighborMotion = registry.get<Motion>(neighbor);
-        sum += neighborMotion.position;
-        count++;
+vec2 BoidsSystem::flockingForce(int boid) {
+    const float px = grid.pos_x[boid];
+    const float py = grid.pos_y[boid];
+    const vec2 velocity = vec2(grid.vel_x[boid], grid.vel_y[boid]);
+    const float neighbor_radius_sq = BOID_NEIGHBOR_RADIUS * BOID_NEIGHBOR_RADIUS;
+    const float separation_radius_sq = BOID_SEPARATION_RADIUS * BOID_SEPARATION_RADIUS;
+
+    float separation_x = 0, separation_y = 0;
+    float velocity_x = 0, velocity_y = 0;
+    float position_x = 0, position_y = 0;
+    float separation_count = 0;
+    float count = 0;
+
+#ifdef BOIDS_USE_SSE
+    const __m128 px4 = _mm_set1_ps(px);
+    const __m128 py4 = _mm_set1_ps(py);
+    const __m128 neighbor_r2 = _mm_set1_ps(neighbor_radius_sq);
+    const __m128 separation_r2 = _mm_set1_ps(separation_radius_sq);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three_halves = _mm_set1_ps(1.5f);
+    const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+
+    __m128 sep_x4 = zero, sep_y4 = zero, vel_x4 = zero, vel_y4 = zero;
+    __m128 pos_x4 = zero, pos_y4 = zero, sep_count4 = zero, count4 = zero;
+#endif
+
+    int checks = 0;
+    int col = grid.cells[boid] % grid.cols;
+    int row = grid.cells[boid] / grid.cols;
+    int first_col = std::max(col - 1, 0);
+    int last_col = std::min(col + 1, grid.cols - 1);
+    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, grid.rows - 1); r++) {
+        // neighbouring cells of a row are adjacent in cell order, so each row is one run
+        int other = grid.cell_start[r * grid.cols + first_col];
+        int end = grid.cell_start[r * grid.cols + last_col + 1];
+        checks += end - other;
+
+#ifdef BOIDS_USE_SSE
+        // four neighbours at a time; lanes past the run or outside the radius are masked off
+        // (the SoA arrays are padded so the last load stays in bounds)
+        for (; other < end; other += 4) {
+            __m128 in_run = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32(other), lanes), _mm_set1_epi32(end)));
+
+            __m128 ox = _mm_loadu_ps(&grid.pos_x[other]);
+            __m128 oy = _mm_loadu_ps(&grid.pos_y[other]);
+            __m128 dx = _mm_sub_ps(px4, ox);
+            __m128 dy = _mm_sub_ps(py4, oy);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            // the boid itself is counted here and taken back out after the loop
+            __m128 near = _mm_and_ps(in_run, _mm_cmplt_ps(d2, neighbor_r2));
+
+            // alignment and cohesion
+            vel_x4 = _mm_add_ps(vel_x4, _mm_and_ps(near, _mm_loadu_ps(&grid.vel_x[other])));
+            vel_y4 = _mm_add_ps(vel_y4, _mm_and_ps(near, _mm_loadu_ps(&grid.vel_y[other])));
+            pos_x4 = _mm_add_ps(pos_x4, _mm_and_ps(near, ox));
+            pos_y4 = _mm_add_ps(pos_y4, _mm_and_ps(near, oy));
+            count4 = _mm_add_ps(count4, _mm_and_ps(near, one));
+
+            // separation adds diff / d^2; 1 / d^2 is the square of a refined rsqrt
+            __m128 close = _mm_and_ps(near, _mm_and_ps(_mm_cmplt_ps(d2, separation_r2), _mm_cmpgt_ps(d2, zero)));
+            __m128 y = _mm_rsqrt_ps(d2);
+            y = _mm_mul_ps(y, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, d2), _mm_mul_ps(y, y))));
+            __m128 inv_d2 = _mm_mul_ps(y, y);
+            sep_x4 = _mm_add_ps(sep_x4, _mm_and_ps(close, _mm_mul_ps(dx, inv_d2)));
+            sep_y4 = _mm_add_ps(sep_y4, _mm_and_ps(close, _mm_mul_ps(dy, inv_d2)));
+            sep_count4 = _mm_add_ps(sep_count4, _mm_and_ps(close, one));
+        }
+#else
+        for (; other < end; other++) {
+            if (other == boid) continue;
+
+            float dx = px - grid.pos_x[other];
+            float dy = py - grid.pos_y[other];
+            float distance_sq = dx * dx + dy * dy;
+            if (distance_sq >= neighbor_radius_sq) continue;
+
+            // alignment and cohesion
+            velocity_x += grid.vel_x[other];
+            velocity_y += grid.vel_y[other];
+            position_x += grid.pos_x[other];
+            position_y += grid.pos_y[other];
+            count++;
+
+            // separation, weighted by distance (closer neighbors have more influence)
+            if (distance_sq < separation_radius_sq && distance_sq > 0) {
+                float inv_distance_sq = 1.f / distance_sq;
+                separation_x += dx * inv_distance_sq;
+                separation_y += dy * inv_distance_sq;
+                separation_count++;
+            }
+        }
+#endif
     }
-    
+
+    // the boid itself is not a check
+    grid.neighbor_checks[boid] = checks - 1;
+
+#ifdef BOIDS_USE_SSE
+    separation_x = horizontalSum(sep_x4);
+    separation_y = horizontalSum(sep_y4);
+    separation_count = horizontalSum(sep_count4);
+
+    // take the boid's own lane back out
+    velocity_x = horizontalSum(vel_x4) - velocity.x;
+    velocity_y = horizontalSum(vel_y4) - velocity.y;
+    position_x = horizontalSum(pos_x4) - px;
+    position_y = horizontalSum(pos_y4) - py;
+    count = horizontalSum(count4) - 1;
+#endif
+
+    vec2 sep(0, 0);
+    vec2 separation_sum(separation_x, separation_y);
+    if (separation_count > 0) {
+        separation_sum = separation_sum / separation_count;
+    }
+    if (dot(separation_sum, separation_sum) > 0) {
+        sep = limit(withLength(separation_sum, BOID_MAX_SPEED) - velocity, BOID_MAX_FORCE);
+    }
+
+    vec2 ali(0, 0);
+    vec2 coh(0, 0);
     if (count > 0) {
-        sum = sum / static_cast<float>(count);
-        return seek(entity, sum);
+        vec2 average_velocity = vec2(velocity_x, velocity_y) / count;
+        ali = limit(withLength(average_velocity, BOID_MAX_SPEED) - velocity, BOID_MAX_FORCE);
+        coh = seek(vec2(px, py), velocity, vec2(position_x, position_y) / count);
     }
-    
-    return vec2(0, 0);
+
+    return sep * BOID_SEPARATION_WEIGHT + ali * BOID_ALIGNMENT_WEIGHT + coh * BOID_COHESION_WEIGHT;
 }
 
-vec2 BoidsSystem::wander(entt::entity entity) {
-    Motion& motion = registry.get<Motion>(entity);
-    Boid& boid = registry.get<Boid>(entity);
-    
+vec2 BoidsSystem::wander(Boid& boid, const vec2& velocity, float jitter) {
     // Update the wander angle with a small random value
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(-0.3f, 0.3f);
-    boid.wanderAngle += dis(gen);
+    boid.wanderAngle += jitter;
     
     // Calculate the wander force
-    vec2 circleCenter = normalize(motion.velocity);
-    if (length(circleCenter) < 0.01f) {
-        circleCenter = vec2(1, 0);
+    vec2 circleCenter = withLength(velocity, 30.0f);
+    if (dot(circleCenter, circleCenter) == 0) {
+        circleCenter = vec2(30.0f, 0);
     }
     
-    circleCenter *= 30.0f;
-    
     vec2 displacement = vec2(cos(boid.wanderAngle), sin(boid.wanderAngle)) * 10.0f;
     vec2 wanderForce = circleCenter + displacement;
     
     return limit(wanderForce, BOID_MAX_FORCE);
 }
 
-vec2 BoidsSystem::seek(entt::entity entity, const vec2& target) {
-    const Motion& motion = registry.get<Motion>(entity);
-    
-    vec2 desired = target - motion.position;
-    if (length(desired) > 0) {
-        desired = normalize(desired) * BOID_MAX_SPEED;
-    }
-    
-    vec2 steer = desired - motion.velocity;
+vec2 BoidsSystem::wallAvoidance(const vec2& position, const vec2& velocity) const {
+    // read-only during the update, so safe to sample from every worker
+    const DistanceField& field = world.map_system.getDistanceField();
+    if (field.empty())
+        return vec2(0.0f);
+
+    float distance = field.sample(position);
+    if (distance >= BOID_WALL_AVOID_DISTANCE)
+        return vec2(0.0f);
+
+    vec2 away = field.gradient(position);
+    float urgency = 1.0f - distance / BOID_WALL_AVOID_DISTANCE;
+
+    // cancel the part of the velocity heading into the wall, then push off it
+    vec2 force = away * BOID_MAX_FORCE * BOID_WALL_AVOID_WEIGHT * urgency;
+    float into = dot(velocity, away);
+    if (into < 0.0f)
+        force -= away * into * urgency;
+    return force;
+}
+
+vec2 BoidsSystem::seek(const vec2& position, const vec2& velocity, const vec2& target) {
+    vec2 desired = withLength(target - position, BOID_MAX_SPEED);
+    vec2 steer = desired - velocity;
     return limit(steer, BOID_MAX_FORCE);
 }
 
 vec2 BoidsSystem::limit(const vec2& vector, float max) {
-    if (length(vector) > max) {
-        return normalize(vector) * max;
+    float length_sq = dot(vector, vector);
+    if (length_sq > max * max) {
+        return vector * (max / std::sqrt(length_sq));
     }
     return vector;
 }
 
-std::vector<entt::entity> BoidsSystem::getNeighbors(entt::entity entity, float radius) {
-    std::vector<entt::entity> neighbors;
-    
-    const Motion& motion = registry.get<Motion>(entity);
-    auto view = registry.view<Boid, Motion>();
-    
-    for (auto neighbor : view) {
-        if (neighbor == entity) continue;
-        
-        const Motion& neighborMotion = registry.get<Motion>(neighbor);
-        float distance = length(motion.position - neighborMotion.position);
-        
-        if (distance < radius) {
-            neighbors.push_back(neighbor);
-        }
+vec2 BoidsSystem::withLength(const vec2& vector, float new_length) {
+    float length_sq = dot(vector, vector);
+    if (length_sq > 0) {
+        return vector * (new_length / std::sqrt(length_sq));
     }
-    
-    return neighbors;
+    return vector;
 }
 
-entt::entity createBoid(RenderSystem* renderer, vec2 position);
-void createBoidsFlock(RenderSystem* renderer, vec2 center, float radius, int count);
+entt::entity createBoid(World& world, RenderSystem* renderer, vec2 position);
+void createBoidsFlock(World& world, RenderSystem* renderer, vec2 center, float radius, int count);
 
-entt::entity createBoid(RenderSystem* renderer, vec2 position) {
-    return BoidsSystem::createBoid(renderer, position);
+entt::entity createBoid(World& world, RenderSystem* renderer, vec2 position) {
+    return BoidsSystem::createBoid(world, renderer, position);
 }
 
-void createBoidsFlock(RenderSystem* renderer, vec2 center, float radius, int count) {
-    BoidsSystem::createBoidsFlock(renderer, center, radius, count);
+void createBoidsFlock(World& world, RenderSystem* renderer, vec2 center, float radius, int count) {
+    BoidsSystem::createBoidsFlock(world, renderer, center, radius, count);
 }
\ No newline at end of file
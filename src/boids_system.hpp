@@ -6,6 +6,8 @@
 #include "tinyECS/registry.hpp"
 #include "render_system.hpp"
 
+class World;
+
 // Flocking behavior parameters
 constexpr float BOID_MAX_SPEED = 100.0f;
 constexpr float BOID_MAX_FORCE = 0.5f;
@@ -15,32 +17,91 @@ constexpr float BOID_SEPARATION_WEIGHT = 1.5f;
 constexpr float BOID_ALIGNMENT_WEIGHT = 1.0f;
 constexpr float BOID_COHESION_WEIGHT = 1.0f;
 constexpr float BOID_WANDER_WEIGHT = 0.3f;
+constexpr float BOID_WALL_AVOID_DISTANCE = 48.0f; // px from a wall where boids start turning away
+constexpr float BOID_WALL_AVOID_WEIGHT = 4.0f;
 const float padding = 50.0f; // Small padding from the screen edge
 
+// counters from the last updateBoids call
+struct BoidsStats {
+    int boids = 0;
+    int grid_cells = 0;
+    long long neighbor_checks = 0; // candidate pairs read from the 3x3 cell blocks
+};
+
 // System to manage boid behaviors
 class BoidsSystem {
 public:
     // Initialize the system
-    BoidsSystem();
+    explicit BoidsSystem(World& world);
 
-    // Create a new boid at the specified position
-    static entt::entity createBoid(RenderSystem* renderer, vec2 position);
+    // Create a new boid at the specified position; renderer may be null (headless), which skips the mesh
+    static entt::entity createBoid(World& world, RenderSystem* renderer, vec2 position);
 
     // Create multiple boids randomly distributed within a radius
-    static void createBoidsFlock(RenderSystem* renderer, vec2 center, float radius, int count);
+    static void createBoidsFlock(World& world, RenderSystem* renderer, vec2 center, float radius, int count);
 
     // Update all boids (call in WorldSystem::step)
-    static void updateBoids(float elapsed_ms);
+    void updateBoids(float elapsed_ms);
+
+    const BoidsStats& lastUpdateStats() const { return stats; }
 
 private:
-    // BOID behaviors (calculated for each boid)
-    static vec2 separation(entt::entity entity, const std::vector<entt::entity>& neighbors);
-    static vec2 alignment(entt::entity entity, const std::vector<entt::entity>& neighbors);
-    static vec2 cohesion(entt::entity entity, const std::vector<entt::entity>& neighbors);
-    static vec2 wander(entt::entity entity);
+    // Uniform grid over the flock, rebuilt every update with a counting sort.
+    // Snapshots are stored in cell order, so the boids of one cell are contiguous.
+    // All buffers are reused between frames and only grow with the flock.
+    struct FlockGrid {
+        vec2 origin = {0, 0};
+        float cell_size = BOID_NEIGHBOR_RADIUS;
+        int cols = 0;
+        int rows = 0;
+
+        std::vector<int> cell_start;   // cols * rows + 1 offsets into the sorted arrays
+        std::vector<int> cell_fill;    // scatter cursor per cell
+
+        // view order
+        std::vector<Motion*> view_motions;
+        std::vector<Boid*> view_boids;
+        std::vector<int> view_cells;
+
+        // cell order
+        std::vector<Motion*> motions;
+        std::vector<Boid*> boids;
+        // structure of arrays so the neighbour kernel can load four boids at once
+        std::vector<float> pos_x;
+        std::vector<float> pos_y;
+        std::vector<float> vel_x;
+        std::vector<float> vel_y;
+        std::vector<int> cells;
+
+        // next state, written by the update workers
+        std::vector<vec2> next_positions;
+        std::vector<vec2> next_velocities;
+        std::vector<float> next_angles;
+        std::vector<float> wander_jitter;
+
+        // per boid, so workers never share a counter
+        std::vector<int> neighbor_checks;
+    };
+
+    // separation, alignment and cohesion for one boid, from a single pass over its grid neighbours
+    vec2 flockingForce(int boid);
+    static vec2 wander(Boid& boid, const vec2& velocity, float jitter);
+
+    // steer away from walls and locked doors using the level's distance field
+    vec2 wallAvoidance(const vec2& position, const vec2& velocity) const;
+
+    // steer and move one boid from the snapshot into the next-state buffers
+    void integrateBoid(int boid, float deltaTime);
     
     // Helper functions
     static vec2 limit(const vec2& vector, float max);
-    static vec2 seek(entt::entity entity, const vec2& target);
-    static std::vector<entt::entity> getNeighbors(entt::entity entity, float radius);
+    static vec2 withLength(const vec2& vector, float new_length); // zero vectors stay zero
+    static vec2 seek(const vec2& position, const vec2& velocity, const vec2& target);
+
+    // snapshot boid positions/velocities (the read buffer) and bin them into the neighbour grid
+    void buildGrid();
+
+    World& world;
+    FlockGrid grid;
+    BoidsStats stats;
 };
\ No newline at end of file
@@ -74,6 +74,13 @@ const int CHEESE_POINTS = 10;
 const float PATROL_SPEED = 50.0f;
 const int PATROL_RANGE = 2;
 
+// AI level of detail: agents further from Tom think less often
+const int AI_NEAR_TILES = 6;              // full rate within this many tiles
+const int AI_MID_TILES = 14;
+const float AI_MID_INTERVAL_MS = 50.f;
+const float AI_FAR_INTERVAL_MS = 200.f;
+const int AI_AGENTS_PER_FRAME = 64;       // update budget per frame
+
 // These are hard coded to the dimensions of the entity's texture
 
 // invaders are 64x64 px, but cells are 60x60
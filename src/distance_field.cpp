@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+
+#include "distance_field.hpp"
+
+namespace {
+    const float DIAGONAL_STEP = 1.41421356f;
+}
+
+void DistanceField::build(int width, int height, const std::vector<ivec2>& blocked_cells) {
+    map_width = width;
+    map_height = height;
+    blocked.assign(width * height, 0);
+    distance.assign(width * height, (float)DISTANCE_FIELD_MAX_TILES);
+    for (ivec2 cell : blocked_cells) {
+        if (cell.x >= 0 && cell.y >= 0 && cell.x < width && cell.y < height)
+            blocked[cell.y * width + cell.x] = 1;
+    }
+    if (width > 0 && height > 0)
+        recompute({0, 0}, {width - 1, height - 1});
+}
+
+void DistanceField::clear() {
+    map_width = 0;
+    map_height = 0;
+    blocked.clear();
+    distance.clear();
+}
+
+bool DistanceField::isBlocked(ivec2 cell) const {
+    if (cell.x < 0 || cell.y < 0 || cell.x >= map_width || cell.y >= map_height)
+        return true;
+    return blocked[cell.y * map_width + cell.x] != 0;
+}
+
+void DistanceField::setBlocked(ivec2 cell, bool is_blocked) {
+    if (cell.x < 0 || cell.y < 0 || cell.x >= map_width || cell.y >= map_height)
+        return;
+    unsigned char& slot = blocked[cell.y * map_width + cell.x];
+    if ((slot != 0) == is_blocked)
+        return;
+    slot = is_blocked ? 1 : 0;
+
+    // past the cap nothing can change
+    int reach = DISTANCE_FIELD_MAX_TILES;
+    recompute({std::max(cell.x - reach, 0), std::max(cell.y - reach, 0)},
+              {std::min(cell.x + reach, map_width - 1), std::min(cell.y + reach, map_height - 1)});
+}
+
+void DistanceField::recompute(ivec2 min_cell, ivec2 max_cell) {
+    // every obstacle that can be within the cap of the rectangle, plus one ring
+    // outside the map (off-map cells count as blocked)
+    int margin = DISTANCE_FIELD_MAX_TILES + 1;
+    int x0 = std::max(min_cell.x - margin, -1);
+    int y0 = std::max(min_cell.y - margin, -1);
+    int x1 = std::min(max_cell.x + margin, map_width);
+    int y1 = std::min(max_cell.y + margin, map_height);
+    int w = x1 - x0 + 1;
+    int h = y1 - y0 + 1;
+
+    window.resize(w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++)
+            window[y * w + x] = isBlocked({x0 + x, y0 + y}) ? 0.f : (float)DISTANCE_FIELD_MAX_TILES;
+    }
+
+    // forward pass: left, top-left, top, top-right
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            float& d = window[y * w + x];
+            if (x > 0)
+                d = std::min(d, window[y * w + x - 1] + 1.f);
+            if (y > 0) {
+                const float* above = &window[(y - 1) * w + x];
+                d = std::min(d, above[0] + 1.f);
+                if (x > 0)
+                    d = std::min(d, above[-1] + DIAGONAL_STEP);
+                if (x < w - 1)
+                    d = std::min(d, above[1] + DIAGONAL_STEP);
+            }
+        }
+    }
+
+    // backward pass: right, bottom-right, bottom, bottom-left
+    for (int y = h - 1; y >= 0; y--) {
+        for (int x = w - 1; x >= 0; x--) {
+            float& d = window[y * w + x];
+            if (x < w - 1)
+                d = std::min(d, window[y * w + x + 1] + 1.f);
+            if (y < h - 1) {
+                const float* below = &window[(y + 1) * w + x];
+                d = std::min(d, below[0] + 1.f);
+                if (x > 0)
+                    d = std::min(d, below[-1] + DIAGONAL_STEP);
+                if (x < w - 1)
+                    d = std::min(d, below[1] + DIAGONAL_STEP);
+            }
+        }
+    }
+
+    for (int y = min_cell.y; y <= max_cell.y; y++) {
+        for (int x = min_cell.x; x <= max_cell.x; x++)
+            distance[y * map_width + x] = window[(y - y0) * w + (x - x0)];
+    }
+}
+
+float DistanceField::distanceAt(ivec2 cell) const {
+    if (cell.x < 0 || cell.y < 0 || cell.x >= map_width || cell.y >= map_height)
+        return 0.f;
+    return distance[cell.y * map_width + cell.x];
+}
+
+float DistanceField::tileDistance(float x, float y) const {
+    // x, y in tiles with tile centres on integers
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    ivec2 cell = ivec2((int)fx, (int)fy);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    float d00 = distanceAt(cell);
+    float d10 = distanceAt(cell + ivec2(1, 0));
+    float d01 = distanceAt(cell + ivec2(0, 1));
+    float d11 = distanceAt(cell + ivec2(1, 1));
+    float top = d00 + (d10 - d00) * tx;
+    float bottom = d01 + (d11 - d01) * tx;
+    return top + (bottom - top) * ty;
+}
+
+float DistanceField::sample(vec2 position) const {
+    float x = position.x / GRID_CELL_WIDTH_PX - 0.5f;
+    float y = position.y / GRID_CELL_HEIGHT_PX - 0.5f;
+
+    // centre distances are half a tile further than the wall edge
+    return std::max(tileDistance(x, y) - 0.5f, 0.f) * GRID_CELL_WIDTH_PX;
+}
+
+vec2 DistanceField::gradient(vec2 position) const {
+    float x = position.x / GRID_CELL_WIDTH_PX - 0.5f;
+    float y = position.y / GRID_CELL_HEIGHT_PX - 0.5f;
+    const float h = 0.5f;
+
+    vec2 g = vec2(tileDistance(x + h, y) - tileDistance(x - h, y),
+                  tileDistance(x, y + h) - tileDistance(x, y - h));
+    float length_sq = dot(g, g);
+    if (length_sq < 1e-8f)
+        return vec2(0.f);
+    return g / std::sqrt(length_sq);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+
+// tiles past this distance all read as "far"; keeps local updates bounded
+const int DISTANCE_FIELD_MAX_TILES = 8;
+
+// Distance from every tile to the nearest blocked tile (walls and locked doors), in tiles
+// between tile centres. Built with a two-pass chamfer transform (1 / sqrt(2) steps) and
+// capped at DISTANCE_FIELD_MAX_TILES. Cells outside the map count as blocked.
+// Lookups are O(1); sample() interpolates bilinearly between tile centres.
+class DistanceField {
+public:
+    void build(int width, int height, const std::vector<ivec2>& blocked_cells);
+
+    void clear();
+
+    // block or unblock one tile and recompute only the tiles it can affect
+    void setBlocked(ivec2 cell, bool blocked);
+
+    bool isBlocked(ivec2 cell) const;
+
+    // tile-centre distance in tiles; 0 on blocked or outside cells
+    float distanceAt(ivec2 cell) const;
+
+    // approximate distance in pixels from a world position to the nearest blocked tile's edge
+    float sample(vec2 position) const;
+
+    // unit direction in which sample() grows fastest (away from walls); zero in open space
+    vec2 gradient(vec2 position) const;
+
+    bool empty() const { return distance.empty(); }
+
+private:
+    // recompute the rectangle [min, max] (inclusive), reading obstacles up to the cap around it
+    void recompute(ivec2 min_cell, ivec2 max_cell);
+
+    float tileDistance(float x, float y) const;
+
+    int map_width = 0;
+    int map_height = 0;
+
+    std::vector<unsigned char> blocked;  // [row * width + col]
+    std::vector<float> distance;         // [row * width + col], in tiles
+
+    // scratch grid for recompute, reused between updates
+    std::vector<float> window;
+};
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <queue>
+#include <functional>
+#include <cstdlib>
+
+#include "hpa_star.hpp"
+
+namespace {
+    const ivec2 NEIGHBOUR_STEPS[4] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0} };
+
+    // entrances at least this wide get a transition at both ends instead of one in the middle
+    const int WIDE_ENTRANCE = 6;
+
+    int cellDistance(ivec2 a, ivec2 b) {
+        return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+    }
+}
+
+HierarchicalPathfinder::HierarchicalPathfinder(int cluster_size) : cluster_size(cluster_size) {
+}
+
+bool HierarchicalPathfinder::isWalkable(ivec2 cell) const {
+    if (cell.x < 0 || cell.y < 0 || cell.x >= map_width || cell.y >= map_height)
+        return false;
+    return walkable[cell.y * map_width + cell.x] != 0;
+}
+
+int HierarchicalPathfinder::clusterOf(ivec2 cell) const {
+    return (cell.y / cluster_size) * clusters_x + (cell.x / cluster_size);
+}
+
+void HierarchicalPathfinder::clusterBounds(int cluster, ivec2& min_cell, ivec2& max_cell) const {
+    int cx = cluster % clusters_x;
+    int cy = cluster / clusters_x;
+    min_cell = { cx * cluster_size, cy * cluster_size };
+    max_cell = { std::min((cx + 1) * cluster_size, map_width) - 1, std::min((cy + 1) * cluster_size, map_height) - 1 };
+}
+
+int HierarchicalPathfinder::addNode(ivec2 cell) {
+    int cell_index = cell.y * map_width + cell.x;
+    auto it = node_at_cell.find(cell_index);
+    if (it != node_at_cell.end())
+        return it->second;
+
+    int id = (int)nodes.size();
+    int cluster = clusterOf(cell);
+    nodes.push_back({cell, cluster});
+    edges.emplace_back();
+    cluster_nodes[cluster].push_back(id);
+    node_at_cell[cell_index] = id;
+    return id;
+}
+
+void HierarchicalPathfinder::addEdge(int a, int b, int cost) {
+    for (Edge& edge : edges[a]) {
+        if (edge.to == b) {
+            edge.cost = std::min(edge.cost, cost);
+            for (Edge& back : edges[b]) {
+                if (back.to == a)
+                    back.cost = edge.cost;
+            }
+            return;
+        }
+    }
+    edges[a].push_back({b, cost});
+    edges[b].push_back({a, cost});
+}
+
+size_t HierarchicalPathfinder::edgeCount() const {
+    size_t count = 0;
+    for (const auto& list : edges)
+        count += list.size();
+    return count / 2;
+}
+
+// scan a shared border cell by cell; every maximal run of cells that are walkable on
+// both sides is one entrance
+void HierarchicalPathfinder::addEntrances(ivec2 first_a, ivec2 first_b, ivec2 along, int span) {
+    int run_start = -1;
+    for (int k = 0; k <= span; k++) {
+        bool open = false;
+        if (k < span) {
+            ivec2 offset = { along.x * k, along.y * k };
+            open = isWalkable(first_a + offset) && isWalkable(first_b + offset);
+        }
+
+        if (open && run_start < 0) {
+            run_start = k;
+        } else if (!open && run_start >= 0) {
+            int run_length = k - run_start;
+            std::vector<int> transitions;
+            if (run_length < WIDE_ENTRANCE) {
+                transitions.push_back(run_start + run_length / 2);
+            } else {
+                transitions.push_back(run_start);
+                transitions.push_back(k - 1);
+            }
+
+            for (int t : transitions) {
+                ivec2 offset = { along.x * t, along.y * t };
+                int a = addNode(first_a + offset);
+                int b = addNode(first_b + offset);
+                addEdge(a, b, 1);
+            }
+            run_start = -1;
+        }
+    }
+}
+
+void HierarchicalPathfinder::clusterDistances(int cluster, ivec2 source) const {
+    ivec2 min_cell, max_cell;
+    clusterBounds(cluster, min_cell, max_cell);
+    int cluster_width = max_cell.x - min_cell.x + 1;
+
+    std::fill(scratch_distance.begin(), scratch_distance.end(), -1);
+    scratch_queue.clear();
+    if (!isWalkable(source))
+        return;
+
+    scratch_distance[(source.y - min_cell.y) * cluster_width + (source.x - min_cell.x)] = 0;
+    scratch_queue.push_back(source);
+
+    for (size_t head = 0; head < scratch_queue.size(); head++) {
+        ivec2 cell = scratch_queue[head];
+        int distance = scratch_distance[(cell.y - min_cell.y) * cluster_width + (cell.x - min_cell.x)];
+
+        for (const ivec2& step : NEIGHBOUR_STEPS) {
+            ivec2 next = cell + step;
+            if (next.x < min_cell.x || next.y < min_cell.y || next.x > max_cell.x || next.y > max_cell.y)
+                continue;
+            if (!isWalkable(next))
+                continue;
+
+            int& next_distance = scratch_distance[(next.y - min_cell.y) * cluster_width + (next.x - min_cell.x)];
+            if (next_distance >= 0)
+                continue;
+            next_distance = distance + 1;
+            scratch_queue.push_back(next);
+        }
+    }
+}
+
+int HierarchicalPathfinder::clusterDistanceTo(int cluster, ivec2 cell) const {
+    ivec2 min_cell, max_cell;
+    clusterBounds(cluster, min_cell, max_cell);
+    int cluster_width = max_cell.x - min_cell.x + 1;
+    return scratch_distance[(cell.y - min_cell.y) * cluster_width + (cell.x - min_cell.x)];
+}
+
+void HierarchicalPathfinder::connectClusterNodes(int cluster) {
+    const std::vector<int>& members = cluster_nodes[cluster];
+    for (size_t i = 0; i < members.size(); i++) {
+        clusterDistances(cluster, nodes[members[i]].cell);
+        for (size_t j = i + 1; j < members.size(); j++) {
+            int distance = clusterDistanceTo(cluster, nodes[members[j]].cell);
+            if (distance > 0)
+                addEdge(members[i], members[j], distance);
+        }
+    }
+}
+
+void HierarchicalPathfinder::build(const std::vector<std::vector<Tile>>& tile_map) {
+    map_height = (int)tile_map.size();
+    map_width = 0;
+    for (const auto& row : tile_map)
+        map_width = std::max(map_width, (int)row.size());
+
+    walkable.assign(map_width * map_height, 0);
+    for (int row = 0; row < map_height; row++) {
+        for (int col = 0; col < (int)tile_map[row].size(); col++) {
+            walkable[row * map_width + col] = tile_map[row][col].walkable ? 1 : 0;
+        }
+    }
+
+    clusters_x = (map_width + cluster_size - 1) / cluster_size;
+    clusters_y = (map_height + cluster_size - 1) / cluster_size;
+
+    nodes.clear();
+    edges.clear();
+    node_at_cell.clear();
+    cluster_nodes.assign(clusters_x * clusters_y, {});
+    scratch_distance.assign(cluster_size * cluster_size, -1);
+    scratch_queue.reserve(cluster_size * cluster_size);
+
+    // entrances between horizontally and vertically adjacent clusters
+    for (int cy = 0; cy < clusters_y; cy++) {
+        for (int cx = 0; cx < clusters_x; cx++) {
+            int x_start = cx * cluster_size;
+            int y_start = cy * cluster_size;
+            int cols = std::min(cluster_size, map_width - x_start);
+            int rows = std::min(cluster_size, map_height - y_start);
+
+            if (cx + 1 < clusters_x) {
+                int border_x = x_start + cluster_size - 1;
+                addEntrances({border_x, y_start}, {border_x + 1, y_start}, {0, 1}, rows);
+            }
+            if (cy + 1 < clusters_y) {
+                int border_y = y_start + cluster_size - 1;
+                addEntrances({x_start, border_y}, {x_start, border_y + 1}, {1, 0}, cols);
+            }
+        }
+    }
+
+    // intra-cluster edges between every pair of entrances that can reach each other
+    for (int cluster = 0; cluster < clusters_x * clusters_y; cluster++)
+        connectClusterNodes(cluster);
+}
+
+bool HierarchicalPathfinder::findAbstractPath(ivec2 start, ivec2 goal, HpaPath& out_path) const {
+    out_path.waypoints.clear();
+    out_path.cost = 0;
+
+    if (!isWalkable(start) || !isWalkable(goal))
+        return false;
+
+    if (start == goal) {
+        out_path.waypoints.push_back(start);
+        return true;
+    }
+
+    int start_cluster = clusterOf(start);
+    int goal_cluster = clusterOf(goal);
+
+    // same cluster: try the direct in-cluster route first
+    if (start_cluster == goal_cluster) {
+        clusterDistances(goal_cluster, goal);
+        int distance = clusterDistanceTo(goal_cluster, start);
+        if (distance >= 0) {
+            out_path.waypoints = { start, goal };
+            out_path.cost = distance;
+            return true;
+        }
+    }
+
+    // temporarily link start and goal to the entrances of their clusters
+    std::vector<Edge> goal_links;
+    clusterDistances(goal_cluster, goal);
+    for (int node : cluster_nodes[goal_cluster]) {
+        int distance = clusterDistanceTo(goal_cluster, nodes[node].cell);
+        if (distance >= 0)
+            goal_links.push_back({node, distance});
+    }
+
+    std::vector<Edge> start_links;
+    clusterDistances(start_cluster, start);
+    for (int node : cluster_nodes[start_cluster]) {
+        int distance = clusterDistanceTo(start_cluster, nodes[node].cell);
+        if (distance >= 0)
+            start_links.push_back({node, distance});
+    }
+
+    if (goal_links.empty() || start_links.empty())
+        return false;
+
+    const int node_count = (int)nodes.size();
+    const int START = node_count;
+    const int GOAL = node_count + 1;
+
+    if ((int)search_g.size() < node_count + 2) {
+        search_g.resize(node_count + 2);
+        search_parent.resize(node_count + 2);
+        search_stamp.resize(node_count + 2, 0);
+        search_closed.resize(node_count + 2, 0);
+    }
+    search_generation++;
+
+    auto cellOf = [&](int id) { return id == START ? start : (id == GOAL ? goal : nodes[id].cell); };
+    auto heuristic = [&](int id) { return cellDistance(cellOf(id), goal); };
+
+    using QueueItem = std::pair<int, int>; // (fScore, node)
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> open;
+
+    auto relax = [&](int from, int to, int cost) {
+        int g = search_g[from] + cost;
+        if (search_stamp[to] == search_generation && (search_closed[to] == search_generation || search_g[to] <= g))
+            return;
+        search_stamp[to] = search_generation;
+        search_g[to] = g;
+        search_parent[to] = from;
+        open.push({g + heuristic(to), to});
+    };
+
+    search_stamp[START] = search_generation;
+    search_g[START] = 0;
+    search_parent[START] = -1;
+    open.push({heuristic(START), START});
+
+    bool found = false;
+    while (!open.empty()) {
+        QueueItem item = open.top();
+        open.pop();
+        int id = item.second;
+
+        // skip stale queue entries
+        if (search_closed[id] == search_generation)
+            continue;
+        search_closed[id] = search_generation;
+
+        if (id == GOAL) {
+            found = true;
+            break;
+        }
+
+        if (id == START) {
+            for (const Edge& edge : start_links)
+                relax(id, edge.to, edge.cost);
+            continue;
+        }
+
+        for (const Edge& edge : edges[id])
+            relax(id, edge.to, edge.cost);
+
+        if (nodes[id].cluster == goal_cluster) {
+            for (const Edge& edge : goal_links) {
+                if (edge.to == id)
+                    relax(id, GOAL, edge.cost);
+            }
+        }
+    }
+
+    if (!found)
+        return false;
+
+    for (int id = GOAL; id != -1; id = search_parent[id]) {
+        ivec2 cell = cellOf(id);
+        // start or goal can sit exactly on an entrance
+        if (out_path.waypoints.empty() || out_path.waypoints.back() != cell)
+            out_path.waypoints.push_back(cell);
+    }
+    std::reverse(out_path.waypoints.begin(), out_path.waypoints.end());
+    out_path.cost = search_g[GOAL];
+    return true;
+}
+
+bool HierarchicalPathfinder::clusterPath(int cluster, ivec2 from, ivec2 to, std::vector<ivec2>& out_cells) const {
+    // distances towards the target, then walk downhill from the source
+    clusterDistances(cluster, to);
+    int distance = clusterDistanceTo(cluster, from);
+    if (distance < 0)
+        return false;
+
+    ivec2 min_cell, max_cell;
+    clusterBounds(cluster, min_cell, max_cell);
+
+    ivec2 cell = from;
+    while (distance > 0) {
+        for (const ivec2& step : NEIGHBOUR_STEPS) {
+            ivec2 next = cell + step;
+            if (next.x < min_cell.x || next.y < min_cell.y || next.x > max_cell.x || next.y > max_cell.y)
+                continue;
+            if (clusterDistanceTo(cluster, next) == distance - 1) {
+                cell = next;
+                break;
+            }
+        }
+        distance--;
+        out_cells.push_back(cell);
+    }
+    return true;
+}
+
+void HierarchicalPathfinder::refineSegment(const HpaPath& path, size_t i, std::vector<ivec2>& out_cells) const {
+    if (i + 1 >= path.waypoints.size())
+        return;
+
+    ivec2 from = path.waypoints[i];
+    ivec2 to = path.waypoints[i + 1];
+
+    // inter-cluster edges join neighbouring cells
+    if (cellDistance(from, to) == 1) {
+        out_cells.push_back(to);
+        return;
+    }
+    clusterPath(clusterOf(from), from, to, out_cells);
+}
+
+bool HierarchicalPathfinder::findPath(ivec2 start, ivec2 goal, std::vector<ivec2>& out_path) const {
+    out_path.clear();
+
+    HpaPath abstract_path;
+    if (!findAbstractPath(start, goal, abstract_path))
+        return false;
+
+    out_path.reserve(abstract_path.cost + 1);
+    out_path.push_back(start);
+    for (size_t i = 0; i + 1 < abstract_path.waypoints.size(); i++)
+        refineSegment(abstract_path, i, out_path);
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+// Abstract route returned by HierarchicalPathfinder. Consecutive waypoints are either
+// neighbouring cells across a cluster border or two cells inside the same cluster, so
+// each segment can be refined on its own when the agent actually gets there.
+struct HpaPath {
+    std::vector<ivec2> waypoints; // start first, goal last
+    int cost = 0;                 // length of the refined path in steps
+};
+
+// Hierarchical A* (HPA*) over the tile grid.
+// The grid is split into square clusters; entrances along shared cluster borders become
+// abstract nodes, and nodes inside a cluster are linked by their precomputed in-cluster
+// distances. Queries search this small graph instead of the full grid.
+// Queries reuse internal scratch buffers, so a single instance is not thread-safe.
+class HierarchicalPathfinder {
+public:
+    explicit HierarchicalPathfinder(int cluster_size = 16);
+
+    // precompute clusters, entrances and intra-cluster edges (call at level load)
+    void build(const std::vector<std::vector<Tile>>& tile_map);
+
+    // coarse path through the abstract graph; false if goal is unreachable
+    bool findAbstractPath(ivec2 start, ivec2 goal, HpaPath& out_path) const;
+
+    // appends the cells after waypoint i up to and including waypoint i + 1
+    void refineSegment(const HpaPath& path, size_t i, std::vector<ivec2>& out_cells) const;
+
+    // fully refined path ordered start to goal; false if goal is unreachable
+    bool findPath(ivec2 start, ivec2 goal, std::vector<ivec2>& out_path) const;
+
+    int width() const { return map_width; }
+    int height() const { return map_height; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t edgeCount() const;
+
+private:
+    struct Edge {
+        int to;
+        int cost;
+    };
+
+    struct AbstractNode {
+        ivec2 cell;
+        int cluster;
+    };
+
+    bool isWalkable(ivec2 cell) const;
+    int clusterOf(ivec2 cell) const;
+    void clusterBounds(int cluster, ivec2& min_cell, ivec2& max_cell) const;
+    int addNode(ivec2 cell);
+    void addEdge(int a, int b, int cost);
+    void addEntrances(ivec2 first_a, ivec2 first_b, ivec2 along, int span);
+    void connectClusterNodes(int cluster);
+
+    // BFS restricted to one cluster; fills scratch_distance for the cluster's cells
+    void clusterDistances(int cluster, ivec2 source) const;
+    int clusterDistanceTo(int cluster, ivec2 cell) const;
+    bool clusterPath(int cluster, ivec2 from, ivec2 to, std::vector<ivec2>& out_cells) const;
+
+    int cluster_size;
+    int map_width = 0;
+    int map_height = 0;
+    int clusters_x = 0;
+    int clusters_y = 0;
+
+    std::vector<uint8_t> walkable;
+    std::vector<AbstractNode> nodes;
+    std::vector<std::vector<Edge>> edges;
+    std::vector<std::vector<int>> cluster_nodes;
+    std::unordered_map<int, int> node_at_cell; // cell index -> node
+
+    // per-query scratch
+    mutable std::vector<int> scratch_distance;
+    mutable std::vector<ivec2> scratch_queue;
+    mutable std::vector<int> search_g;
+    mutable std::vector<int> search_parent;
+    mutable std::vector<uint32_t> search_stamp;
+    mutable std::vector<uint32_t> search_closed;
+    mutable uint32_t search_generation = 0;
+};
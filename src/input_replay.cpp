@@ -0,0 +1,141 @@
+#include <cstring>
+
+#include "input_replay.hpp"
+#include "util/logger.hpp"
+
+namespace {
+    const char REPLAY_MAGIC[4] = { 'S', 'Q', 'R', 'P' };
+
+    // fixed-size fields in host order; every platform we ship on is little endian
+    template <class T>
+    void write(std::ofstream& file, T value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool read(std::ifstream& file, T& value) {
+        return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+}
+
+bool InputRecorder::open(const std::string& path, uint64_t seed, int start_level) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open replay file for writing: %s", path.c_str());
+        return false;
+    }
+
+    file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    write<uint32_t>(file, INPUT_REPLAY_VERSION);
+    write<uint64_t>(file, seed);
+    write<int32_t>(file, start_level);
+    pending.clear();
+    frame_count = 0;
+    return true;
+}
+
+void InputRecorder::close() {
+    if (file.is_open()) {
+        file.close();
+        LOG_INFO("Recorded %u frames", frame_count);
+    }
+}
+
+void InputRecorder::record(const InputEvent& event) {
+    if (file.is_open())
+        pending.push_back(event);
+}
+
+void InputRecorder::endFrame(float elapsed_ms) {
+    if (!file.is_open())
+        return;
+
+    write<float>(file, elapsed_ms);
+    write<uint16_t>(file, (uint16_t)pending.size());
+    for (const InputEvent& event : pending) {
+        write<uint8_t>(file, (uint8_t)event.type);
+        switch (event.type) {
+            case InputEventType::KEY:
+                write<int16_t>(file, (int16_t)event.code);
+                write<uint8_t>(file, (uint8_t)event.action);
+                write<uint8_t>(file, (uint8_t)event.mods);
+                break;
+            case InputEventType::MOUSE_MOVE:
+                write<float>(file, event.x);
+                write<float>(file, event.y);
+                break;
+            case InputEventType::MOUSE_BUTTON:
+                write<uint8_t>(file, (uint8_t)event.code);
+                write<uint8_t>(file, (uint8_t)event.action);
+                write<uint8_t>(file, (uint8_t)event.mods);
+                break;
+        }
+    }
+    pending.clear();
+    frame_count++;
+}
+
+bool InputPlayer::open(const std::string& path) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open replay file: %s", path.c_str());
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    int32_t level = -1;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0 ||
+        !read(file, version) || version != INPUT_REPLAY_VERSION ||
+        !read(file, rng_seed) || !read(file, level)) {
+        LOG_ERROR("Not a replay file (or an unsupported version): %s", path.c_str());
+        file.close();
+        return false;
+    }
+    start_level = level;
+    return true;
+}
+
+bool InputPlayer::nextFrame(std::vector<InputEvent>& out_events, float& out_elapsed_ms) {
+    out_events.clear();
+    uint16_t count = 0;
+    if (!file.is_open() || !read(file, out_elapsed_ms) || !read(file, count))
+        return false;
+
+    for (uint16_t i = 0; i < count; i++) {
+        InputEvent event;
+        uint8_t type = 0;
+        if (!read(file, type))
+            return false;
+        event.type = (InputEventType)type;
+
+        bool ok = true;
+        uint8_t action = 0, mods = 0;
+        switch (event.type) {
+            case InputEventType::KEY: {
+                int16_t key = 0;
+                ok = read(file, key) && read(file, action) && read(file, mods);
+                event.code = key;
+                break;
+            }
+            case InputEventType::MOUSE_MOVE:
+                ok = read(file, event.x) && read(file, event.y);
+                break;
+            case InputEventType::MOUSE_BUTTON: {
+                uint8_t button = 0;
+                ok = read(file, button) && read(file, action) && read(file, mods);
+                event.code = button;
+                break;
+            }
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok)
+            return false;
+        event.action = action;
+        event.mods = mods;
+        out_events.push_back(event);
+    }
+    return true;
+}
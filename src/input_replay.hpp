@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// One window input event, as delivered by the GLFW callbacks.
+enum class InputEventType : uint8_t {
+    KEY = 0,
+    MOUSE_MOVE = 1,
+    MOUSE_BUTTON = 2
+};
+
+struct InputEvent {
+    InputEventType type = InputEventType::KEY;
+    int code = 0;    // key or mouse button
+    int action = 0;  // GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT
+    int mods = 0;
+    float x = 0.f;   // cursor position for MOUSE_MOVE
+    float y = 0.f;
+};
+
+// Replay file layout (little endian):
+//   header: "SQRP", u32 version, u64 rng seed, i32 start level (-1 = start screen)
+//   frame:  f32 elapsed_ms, u16 event count, then the events
+//   event:  u8 type, then KEY: i16 key, u8 action, u8 mods
+//                         MOUSE_MOVE: f32 x, f32 y
+//                         MOUSE_BUTTON: u8 button, u8 action, u8 mods
+// Every simulated frame is written, including frames without input, so the
+// replay steps the same elapsed times in the same order.
+const uint32_t INPUT_REPLAY_VERSION = 1;
+
+// Buffers the events of the current frame and writes them when the frame ends.
+class InputRecorder {
+public:
+    bool open(const std::string& path, uint64_t seed, int start_level);
+    void close();
+    bool isOpen() const { return file.is_open(); }
+
+    void record(const InputEvent& event);
+
+    // write the frame's events together with the elapsed time it is stepped with
+    void endFrame(float elapsed_ms);
+
+    uint32_t frameCount() const { return frame_count; }
+
+private:
+    std::ofstream file;
+    std::vector<InputEvent> pending;
+    uint32_t frame_count = 0;
+};
+
+// Reads a replay file back one frame at a time.
+class InputPlayer {
+public:
+    bool open(const std::string& path);
+    bool isOpen() const { return file.is_open(); }
+
+    uint64_t seed() const { return rng_seed; }
+    int startLevel() const { return start_level; }
+
+    // false once the recording is exhausted
+    bool nextFrame(std::vector<InputEvent>& out_events, float& out_elapsed_ms);
+
+private:
+    std::ifstream file;
+    uint64_t rng_seed = 0;
+    int start_level = -1;
+};
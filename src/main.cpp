@@ -4,61 +4,233 @@
 
 // stdlib
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 // internal
 #include "ai_system.hpp"
 #include "physics_system.hpp"
 #include "render_system.hpp"
 #include "world_system.hpp"
+#include "input_replay.hpp"
+#include "system_scheduler.hpp"
+#include "util/alloc_tracker.hpp"
+#include "util/frame_arena.hpp"
+#include "util/job_system.hpp"
+#include "util/logger.hpp"
+#include "util/perf_counters.hpp"
+#include "util/profiler.hpp"
+#include "util/rng.hpp"
 
 #include <entt.hpp>
-#include "tinyECS/registry.hpp"
+#include "world.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
+// headless runs step a fixed 60 Hz frame as fast as they can
+const float HEADLESS_FRAME_MS = 1000.f / 60.f;
+const int HEADLESS_DEFAULT_FRAMES = 3600;
+
 // Entry point
-int main()
+//   squeak [--headless] [--frames N] [--level N] [--record FILE | --replay FILE]
+//          [--trace FILE] [--counters FILE] [--check-systems]
+// --headless runs without a window, renderer or audio; --frames stops after N frames.
+// --level skips the start screen. --record writes every frame's input and elapsed time,
+// --replay plays such a file back (with its seed and level) instead of reading input.
+// --trace writes the profiler's Chrome trace of the last frames on exit, --counters the
+// per-frame work counters as CSV. --check-systems runs the game systems one at a time and
+// warns about component writes they did not declare. It compares the values of declared
+// and watched components, and for all others which entities have them; reads of
+// undeclared components are not detected.
+int main(int argc, char* argv[])
 {
-	// global systems
-	AISystem	  ai_system;
-	WorldSystem   world_system;
-	RenderSystem  renderer_system;
-	PhysicsSystem physics_system;
-
-	// initialize window
-	GLFWwindow* window = world_system.create_window();
-	if (!window) {
-		// Time to read the error message
-		std::cerr << "ERROR: Failed to create window.  Press any key to exit" << std::endl;
-		getchar();
-		return EXIT_FAILURE;
+	bool headless = false;
+	int max_frames = -1;
+	int start_level = -1;
+	std::string record_path;
+	std::string replay_path;
+	std::string trace_path;
+	std::string counters_path;
+	bool check_systems = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--headless") {
+			headless = true;
+		} else if (arg == "--frames" && i + 1 < argc) {
+			max_frames = atoi(argv[++i]);
+		} else if (arg == "--level" && i + 1 < argc) {
+			start_level = atoi(argv[++i]);
+		} else if (arg == "--record" && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (arg == "--replay" && i + 1 < argc) {
+			replay_path = argv[++i];
+		} else if (arg == "--trace" && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (arg == "--counters" && i + 1 < argc) {
+			counters_path = argv[++i];
+		} else if (arg == "--check-systems") {
+			check_systems = true;
+		} else {
+			std::cerr << "unknown argument: " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
 	}
 
-	if (!world_system.start_and_load_sounds()) {
-		std::cerr << "ERROR: Failed to start or load sounds." << std::endl;
+	InputPlayer input_player;
+	if (!replay_path.empty()) {
+		if (!input_player.open(replay_path))
+			return EXIT_FAILURE;
+		// a replay runs to its end and starts where the recording did
+		start_level = input_player.startLevel();
+	} else {
+		if (headless && max_frames < 0)
+			max_frames = HEADLESS_DEFAULT_FRAMES;
+		// nobody can click through the start screen
+		if (headless && start_level < 0)
+			start_level = 0;
+	}
+
+	// one seed for every random stream; set SQUEAK_SEED to reproduce a run
+	uint64_t seed = input_player.isOpen() ? input_player.seed() : Random::seedFromEnvironment();
+	LOG_INFO("Random seed: %llu", (unsigned long long)seed);
+
+	// the entities and run state every system below works on
+	World world(seed);
+	PerfCounters::watchRegistry(world.registry);
+
+	// start the workers now rather than in the middle of the first frame
+	LOG_INFO("Job system: %u worker threads", JobSystem::shared().workerCount());
+
+	// after the systems (locals below) are gone, so what is left is really left over
+	if (AllocTracker::enabled())
+		std::atexit(AllocTracker::report);
+
+	// global systems
+	AISystem	  ai_system(world);
+	WorldSystem   world_system(world);
+	RenderSystem  renderer_system(world);
+	PhysicsSystem physics_system(world);
+
+	if (headless) {
+		// no GLFW, OpenGL or SDL: null audio and a renderer that only holds meshes
+		renderer_system.init_headless();
+		world_system.init(&renderer_system);
+	} else {
+		// initialize window
+		GLFWwindow* window = world_system.create_window();
+		if (!window) {
+			// Time to read the error message
+			LOG_ERROR("Failed to create window.  Press any key to exit");
+			Logger::flush();
+			getchar();
+			return EXIT_FAILURE;
+		}
+
+		if (!world_system.start_and_load_sounds()) {
+			LOG_ERROR("Failed to start or load sounds.");
+		}
+
+		// initialize the main systems
+		renderer_system.init(window);
+		world_system.init(&renderer_system);
 	}
+	if (start_level >= 0)
+		world_system.play_level(start_level);
 
-	// initialize the main systems
-	renderer_system.init(window);
-	world_system.init(&renderer_system);
+	// The PLAYING frame. Systems run in this order wherever their component access
+	// overlaps; anything that adds or removes components or entities is exclusive.
+	auto simulating = [&]() {
+		return world.registry.get<ScreenState>(renderer_system.get_screen_state_entity()).darken_screen_factor < 0;
+	};
+	SystemScheduler game_systems(world.registry);
+	game_systems.setValidation(check_systems);
+	game_systems.add("world", [&](float ms) { world_system.step(ms); })
+		.exclusive();
+	game_systems.add("ai_agents", [&](float) { ai_system.registerAgents(); })
+		.runIf(simulating).exclusive();
+	game_systems.add("ai_animation", [&](float) { ai_system.animateCats(); })
+		.runIf(simulating)
+		.reads<ScreenState, Cat, Motion>()
+		.writes<Animation>();
+	game_systems.add("ai_schedule", [&](float ms) { ai_system.scheduleAgents(ms); })
+		.runIf(simulating)
+		.reads<ScreenState, Motion, Player, PatrolChasing, PatrolReturning>()
+		.writes<AITick>();
+	game_systems.add("ai_snipers", [&](float) { ai_system.processSniperCats(&renderer_system); })
+		.runIf(simulating).exclusive();
+	// also fills the map system's path cache, which is not a component; writing Motion
+	// keeps it from overlapping any other system here
+	game_systems.add("ai_patrols", [&](float) { ai_system.processPatrolCats(); })
+		.runIf(simulating)
+		.reads<ScreenState, Player, Wall, AITick, PatrolWalking, PatrolChasing, PatrolReturning>()
+		.writes<Motion, Patrol>();
+	game_systems.add("ai_transitions", [&](float) { ai_system.applyPatrolTransitions(); })
+		.runIf(simulating).exclusive();
+	game_systems.add("physics", [&](float ms) { physics_system.step(ms); })
+		.runIf(simulating).exclusive();
+	game_systems.add("collisions", [&](float) { world_system.handle_collisions(); })
+		.runIf(simulating).exclusive();
 
-	// variable timestep loop
-	auto t = Clock::now();
-	while (!world_system.is_over()) {
-		
-		// processes system messages, if this wasn't present the window would become unresponsive
-		glfwPollEvents();
+	// for --check-systems: components nobody declares but the AI steps sit next to, and
+	// Patrol, whose vectors are not plain bytes
+	game_systems.watch<Player, Sniper, RenderRequest>();
+	game_systems.watch<Patrol>([](uint64_t hash, const Patrol& patrol) {
+		hash = SystemScheduler::hashBytes(hash, patrol.waypoints.data(), patrol.waypoints.size() * sizeof(vec2));
+		hash = SystemScheduler::hashBytes(hash, &patrol.currentTargetIndex, sizeof(patrol.currentTargetIndex));
+		hash = SystemScheduler::hashBytes(hash, &patrol.lastPatrolPos, sizeof(patrol.lastPatrolPos));
+		hash = SystemScheduler::hashBytes(hash, &patrol.lastTargetIndex, sizeof(patrol.lastTargetIndex));
+		hash = SystemScheduler::hashBytes(hash, &patrol.reversing, sizeof(patrol.reversing));
+		for (const PathStep& step : patrol.returnPath) {
+			hash = SystemScheduler::hashBytes(hash, &step.cell, sizeof(step.cell));
+			hash = SystemScheduler::hashBytes(hash, &step.teleport, sizeof(step.teleport));
+		}
+		return SystemScheduler::hashBytes(hash, &patrol.returnPortalVersion, sizeof(patrol.returnPortalVersion));
+	});
 
-		// calculate elapsed times in milliseconds from the previous iteration
-		auto now = Clock::now();
-		float elapsed_ms =
-			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
-		t = now;
+	InputRecorder input_recorder;
+	if (!record_path.empty()) {
+		if (!input_recorder.open(record_path, seed, start_level))
+			return EXIT_FAILURE;
+		world_system.set_input_recorder(&input_recorder);
+	}
+	world_system.set_ignore_window_input(input_player.isOpen());
+	std::vector<InputEvent> replay_events;
 
-		// CK: be mindful of the order of your systems and rearrange this list only if necessary
+	// variable timestep loop (fixed step when headless)
+	auto start = Clock::now();
+	auto t = start;
+	int frame = 0;
+	while (!world_system.is_over() && (max_frames < 0 || frame < max_frames)) {
+		// averages cover whole frames, so fold the previous one in before timing this one
+		Profiler::endFrame();
+		FrameArena::frame().reset();
+		PerfCounters::add(PerfCounter::FRAME_ARENA_BYTES, FrameArena::frame().lastFrameBytes());
+		AllocTracker::endFrame();
+		PerfCounters::endFrame();
+		PROFILE_SCOPE("frame");
 
-		ScreenState& screen_state = registry.get<ScreenState>(renderer_system.get_screen_state_entity());
+		float elapsed_ms = HEADLESS_FRAME_MS;
+		if (!headless) {
+			// processes system messages, if this wasn't present the window would become unresponsive
+			glfwPollEvents();
+
+			// calculate elapsed times in milliseconds from the previous iteration
+			auto now = Clock::now();
+			elapsed_ms =
+				(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
+			t = now;
+		}
+
+		// a replay supplies both the input and the frame time
+		if (input_player.isOpen()) {
+			if (!input_player.nextFrame(replay_events, elapsed_ms))
+				break;
+			for (const InputEvent& event : replay_events)
+				world_system.apply_input(event);
+		}
+		input_recorder.endFrame(elapsed_ms);
+		world.advanceTime(elapsed_ms);
 
 		GAME_SCREEN_ID game_screen = world_system.get_game_screen();
 
@@ -73,19 +245,33 @@ int main()
 
 				break;
 			case GAME_SCREEN_ID::PLAYING:
-				world_system.step(elapsed_ms);
-				if (screen_state.darken_screen_factor < 0) {
-					ai_system.step(&renderer_system, elapsed_ms);
-					physics_system.step(elapsed_ms);
-					world_system.handle_collisions();
-				}
+				game_systems.run(elapsed_ms);
 				break;
 			default:
 				break;
 		}
 
-		renderer_system.draw(game_screen);
+		if (!headless) {
+			PROFILE_SCOPE("render");
+			renderer_system.draw(game_screen);
+		}
+		frame++;
+	}
+
+	if (headless) {
+		// keep the summary after the run's log output
+		Logger::flush();
+		float total_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+		std::cout << "Simulated " << frame << " frames in " << total_ms << " ms ("
+			<< (frame > 0 ? total_ms / frame : 0.f) << " ms/frame)" << std::endl;
 	}
+	world_system.set_input_recorder(nullptr);
+	input_recorder.close();
+
+	if (!trace_path.empty())
+		Profiler::exportChromeTrace(trace_path);
+	if (!counters_path.empty())
+		PerfCounters::dumpCsv(counters_path);
 
 	return EXIT_SUCCESS;
 }
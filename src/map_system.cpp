@@ -5,12 +5,31 @@
 #include <queue>
 #include <cmath>
 #include <optional>
+#include <algorithm>
 #include "gl3w.h"
 
 #include "map_system.hpp"
+#include "world.hpp"
+#include "util/logger.hpp"
 #include "util/world_grid.hpp"
 #include "a_star.hpp"
 
+namespace {
+    bool sameWalkability(const std::vector<std::vector<Tile>>& a, const std::vector<std::vector<Tile>>& b) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t row = 0; row < a.size(); row++) {
+            if (a[row].size() != b[row].size())
+                return false;
+            for (size_t col = 0; col < a[row].size(); col++) {
+                if (a[row][col].walkable != b[row][col].walkable)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
 // void MapSystem::init() {
 //     // loadLevel(current_level);
 // }
@@ -23,7 +42,7 @@ int MapSystem::loadLevel(int level_index) {
 
     std::ifstream file(level_path);
     if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << level_path << std::endl;
+        LOG_ERROR("Failed to open file: %s", level_path.c_str());
         return 0;
     }
     std::string line;
@@ -32,29 +51,42 @@ int MapSystem::loadLevel(int level_index) {
     // clear patrol cat path end positions
     patrol_positions.clear();
     tile_map.clear();
+    current_map.clear();
 
     while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
         std::stringstream ss(line);
         std::string cell;
         int col = 0;
+        std::vector<std::string> row_cells;
 
-        while (getline(ss, cell, ',') && col < WINDOW_WIDTH_TILES) {
-            if (!cell.empty()) {
-                current_map[row][col] = cell; 
+        while (getline(ss, cell, ',')) {
+            row_cells.push_back(cell);
 
-                // Check if the cell contains a patrol 
-                if (cell[0] == 'X' && cell.size() > 1 && isdigit(cell[1])) {
-                    current_map[row][col] = cell[1];
-                    int patrol_id = cell[1] - '0';
-                    patrol_positions[patrol_id].push_back(vec2(col, row));
-                }
+            // Check if the cell contains a patrol 
+            if (!cell.empty() && cell[0] == 'X' && cell.size() > 1 && isdigit(cell[1])) {
+                row_cells[col] = cell[1];
+                int patrol_id = cell[1] - '0';
+                patrol_positions[patrol_id].push_back(vec2(col, row));
             }
             col++;
         }
+        current_map.push_back(row_cells);
         row++;
-        if (row >= WINDOW_HEIGHT_TILES) break; // Stop if we exceed the map height
     }
 
+    // rows may differ in length; pad to a rectangle with empty cells
+    map_height = (int)current_map.size();
+    map_width = 0;
+    for (const auto& row_cells : current_map)
+        map_width = std::max(map_width, (int)row_cells.size());
+    for (auto& row_cells : current_map)
+        row_cells.resize(map_width);
+
     file.close();
 
     return portal_count;
@@ -69,14 +101,22 @@ std::string MapSystem::getLevelText(int level_index) {
     }
 }
 
-entt::entity MapSystem::createLevel(RenderSystem* renderer) {
+entt::entity MapSystem::createLevel(World& world, RenderSystem* renderer) {
 
     // player created from map but needs to be passed to world_system
     entt::entity player_entity;
 
-    for (int row = 0; row < WINDOW_HEIGHT_TILES; row++) {
+    obstacle_cells.clear();
+
+    // tiles and pickups are counted first and created together at the end
+    PrefabBatch tiles(world.registry);
+    auto addTile = [&](PREFAB_ID id, vec2 grid_pos) {
+        tiles.add(getPrefab(renderer, id), WorldGrid::gridToWorld(grid_pos));
+    };
+
+    for (int row = 0; row < map_height; row++) {
         std::vector<Tile> rowTiles;
-        for (int col = 0; col < WINDOW_WIDTH_TILES; col++) {
+        for (int col = 0; col < map_width; col++) {
             Tile tile;
             tile.walkable = true;
 
@@ -86,58 +126,61 @@ entt::entity MapSystem::createLevel(RenderSystem* renderer) {
             if (cell == "#") {
                 // Render north, east, west wall
                 tile.walkable = false;
-                WorldGrid::createNWEWallAtGridPos(renderer, vec2(col,row));
+                obstacle_cells.push_back(ivec2(col, row));
+                addTile(PREFAB_ID::NWE_WALL, vec2(col,row));
             } else if (cell == "$") {
                 // Render south wall
                 tile.walkable = false;
-                WorldGrid::createSouthWallAtGridPos(renderer, vec2(col,row));
+                obstacle_cells.push_back(ivec2(col, row));
+                addTile(PREFAB_ID::SOUTH_WALL, vec2(col,row));
             } else if (cell == "P") {
                 // Render player
                 tile.walkable = false;
-                player_entity = WorldGrid::createPlayerAtGridPos(renderer,vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                player_entity = WorldGrid::createPlayerAtGridPos(world, renderer,vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell[0] == 'S') {
                 // Render sniper cat facing the specified direction
                 if (cell[1] == 'N') {
-                    WorldGrid::createSniperAtGridPos(renderer, vec2(col,row), Direction::TOP);
+                    WorldGrid::createSniperAtGridPos(world, renderer, vec2(col,row), Direction::TOP);
                 } else if (cell[1] == 'E') {
-                    WorldGrid::createSniperAtGridPos(renderer, vec2(col,row), Direction::RIGHT);
+                    WorldGrid::createSniperAtGridPos(world, renderer, vec2(col,row), Direction::RIGHT);
                 } else if (cell[1] == 'S') {
-                    WorldGrid::createSniperAtGridPos(renderer, vec2(col,row), Direction::BOTTOM);
+                    WorldGrid::createSniperAtGridPos(world, renderer, vec2(col,row), Direction::BOTTOM);
                 } else if (cell[1] == 'W') {
-                    WorldGrid::createSniperAtGridPos(renderer, vec2(col,row), Direction::LEFT);
+                    WorldGrid::createSniperAtGridPos(world, renderer, vec2(col,row), Direction::LEFT);
                 }
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == "K") {
                 // Render key
-                WorldGrid::createKeyAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::KEY, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             }
             else if (cell == "I") {
                 // Render ice
-                WorldGrid::createFloorIceAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::FLOOR_ICE, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == "D") {
                 // Render door
-                WorldGrid::createDoorAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                obstacle_cells.push_back(ivec2(col, row));
+                addTile(PREFAB_ID::DOOR, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == "E") {
                 // Render exit
-                WorldGrid::createExitAtGridPos(renderer, vec2(col,row));
+                addTile(PREFAB_ID::EXIT, vec2(col,row));
             } else if (cell == "C") {
                 // Render cheese
-                WorldGrid::createCheeseAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::CHEESE, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == "T") {
-                WorldGrid::createMousetrapAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::MOUSETRAP, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == "B") {
                 // Render Boomerang
-                WorldGrid::createBoomerangAtGridPos(renderer, vec2(col,row));
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                WorldGrid::createBoomerangAtGridPos(world, renderer, vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
             } else if (cell == ".") {
                 // Render floor
-                WorldGrid::createFloorAtGridPos(vec2(col,row));
+                addTile(PREFAB_ID::FLOOR, vec2(col,row));
                 // WorldGrid::createBlankAtGridPos(vec2(col,row));
             }
             rowTiles.push_back(tile);
@@ -145,16 +188,22 @@ entt::entity MapSystem::createLevel(RenderSystem* renderer) {
         tile_map.push_back(rowTiles);
     }
 
+    // a new walkable layout invalidates every cached path
+    if (!sameWalkability(tile_map, versioned_tile_map)) {
+        map_version++;
+        versioned_tile_map = tile_map;
+        hpa.build(tile_map);
+    }
+
+    distance_field.build(map_width, map_height, obstacle_cells);
+
+    // portals do not survive a level reload
+    portal_graph.clear();
+    portal_version++;
+
     for (auto& [patrol_id, positions] : patrol_positions) {
         if (!positions.empty()) {
-            std::vector<ivec2> path;
-            std::unordered_set<ivec2, PairHash> visited;
-            
-            // create path using A* algorithm
-            StarNode startNode(positions[0].x, positions[0].y, nullptr, 0, 0);
-            StarNode goalNode(positions[1].x, positions[1].y, nullptr, 0, 0);
-            
-            aStar(path, visited, &startNode, &goalNode, tile_map);
+            std::vector<ivec2> path = findPath(ivec2(positions[0]), ivec2(positions[1]));
 
             // convert ivec2 to vec2
             std::vector<glm::vec2> floatPath;
@@ -162,20 +211,82 @@ entt::entity MapSystem::createLevel(RenderSystem* renderer) {
                 floatPath.push_back(glm::vec2(pos));
             }
 
-            WorldGrid::createPatrolEnemyAtGridPos(renderer, floatPath);
-            WorldGrid::createFloorAtGridPos(positions[0]);
-            WorldGrid::createFloorAtGridPos(positions[1]);
+            WorldGrid::createPatrolEnemyAtGridPos(world, renderer, floatPath);
+            addTile(PREFAB_ID::FLOOR, positions[0]);
+            addTile(PREFAB_ID::FLOOR, positions[1]);
         }
     }
 
+    tiles.create();
+
     return player_entity;
 }
 
+std::vector<ivec2> MapSystem::findPath(ivec2 start, ivec2 goal) {
+    std::vector<ivec2> path;
+    if (!path_cache.lookup(start, goal, map_version, path)) {
+        if (map_width > WINDOW_WIDTH_TILES || map_height > WINDOW_HEIGHT_TILES) {
+            // flat A* does not scale past one screen; search the abstract graph instead
+            if (hpa.findPath(start, goal, path))
+                std::reverse(path.begin(), path.end());
+        } else {
+            FrameArenaScope arena_scope;
+            StarVisitedSet visited;
+
+            // create path using A* algorithm
+            StarNode startNode(start.x, start.y, nullptr, 0, 0);
+            StarNode goalNode(goal.x, goal.y, nullptr, 0, 0);
+
+            aStar(path, visited, &startNode, &goalNode, tile_map);
+        }
+
+        path_cache.store(start, goal, map_version, path);
+    }
+    return path;
+}
+
+std::vector<PathStep> MapSystem::findRoute(ivec2 start, ivec2 goal) {
+    std::vector<ivec2> path = findPath(start, goal);
+    std::vector<PathStep> route;
+
+    // going through portals may beat walking (or be the only way there)
+    int portal_cost = portal_graph.routeCost(start, goal);
+    if (portal_cost >= 0 && (path.empty() || portal_cost < (int)path.size() - 1)) {
+        portal_graph.findRoute(start, goal, route);
+        std::reverse(route.begin(), route.end());
+        return route;
+    }
+
+    route.reserve(path.size());
+    for (ivec2 cell : path)
+        route.push_back({cell, false});
+    return route;
+}
+
+void MapSystem::updatePortalGraph(entt::registry& registry) {
+    portal_graph.rebuild(registry, tile_map);
+    portal_version++;
+}
+
+void MapSystem::resetLevel() {
+    distance_field.build(map_width, map_height, obstacle_cells);
+    portal_graph.clear();
+    portal_version++;
+}
+
+void MapSystem::setDoorOpen(ivec2 cell, bool open) {
+    distance_field.setBlocked(cell, !open);
+}
+
 void MapSystem::mapDebugPrint() {
-    for (int row = 0; row < WINDOW_HEIGHT_TILES; row++) {
-        for (int col = 0; col < WINDOW_WIDTH_TILES; col++) {
-            std::cout << current_map[row][col] << " ";
+    for (int row = 0; row < map_height; row++) {
+        std::string line;
+        for (int col = 0; col < map_width; col++) {
+            line += current_map[row][col] + " ";
         }
-        std::cout << std::endl;
+        LOG_DEBUG("%s", line.c_str());
     }
+    LOG_DEBUG("hpa: %zu nodes, %zu edges", hpa.nodeCount(), hpa.edgeCount());
+    LOG_DEBUG("portal exits: %zu", portal_graph.exitCount());
+    LOG_DEBUG("path cache: %llu hits, %llu misses", (unsigned long long)path_cache.hits(), (unsigned long long)path_cache.misses());
 }
\ No newline at end of file
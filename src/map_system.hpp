@@ -7,8 +7,14 @@
 #include <vector>
 
 #include "render_system.hpp"
+#include "path_cache.hpp"
+#include "hpa_star.hpp"
+#include "portal_graph.hpp"
+#include "distance_field.hpp"
 // const std::string map_path = "team-22/data/maps";
 
+class World;
+
 class MapSystem {
 
 public:
@@ -21,7 +27,12 @@ public:
 
     std::string getLevelText(int level_index);
 
-    entt::entity createLevel(RenderSystem* renderer);
+    // creates the entities of the loaded map in world, whose map system this must be
+    entt::entity createLevel(World& world, RenderSystem* renderer);
+
+    // back to the state createLevel left for the current map: locked doors closed, no
+    // portals. For levels restored from a snapshot instead of created again
+    void resetLevel();
 
     void mapDebugPrint();
 
@@ -29,8 +40,41 @@ public:
         return level_texts.size();
     }
 
-    // current map parsed info
-    std::array<std::array<std::string, WINDOW_WIDTH_TILES>, WINDOW_HEIGHT_TILES> current_map = {};
+    // bumped whenever the walkable layout changes; keys the path cache
+    uint32_t getMapVersion() const { return map_version; }
+
+    const PathCache& getPathCache() const { return path_cache; }
+
+    // walking path ordered goal to start (same as aStar); empty if unreachable
+    std::vector<ivec2> findPath(ivec2 start, ivec2 goal);
+
+    // findPath through the placed portals when that is shorter or the only way there,
+    // same order; followers must jump to steps marked teleport instead of walking to them
+    std::vector<PathStep> findRoute(ivec2 start, ivec2 goal);
+
+    // recompute portal distance tables; call after portals are created or removed
+    void updatePortalGraph(entt::registry& registry);
+
+    const PortalGraph& getPortalGraph() const { return portal_graph; }
+
+    // bumped whenever the portal graph is rebuilt or cleared; routes from findRoute
+    // planned under an older version may use portals that are gone
+    uint32_t getPortalVersion() const { return portal_version; }
+
+    // distance to the nearest wall or locked door, rebuilt in createLevel
+    const DistanceField& getDistanceField() const { return distance_field; }
+
+    // locked doors block the distance field; unlocking one only updates the tiles around it
+    void setDoorOpen(ivec2 cell, bool open);
+
+    // walkability of the level built by createLevel, indexed [row][col]
+    const std::vector<std::vector<Tile>>& getTileMap() const { return tile_map; }
+
+    int getMapWidth() const { return map_width; }
+    int getMapHeight() const { return map_height; }
+
+    // current map parsed info, indexed [row][col]; maps may be larger than one screen
+    std::vector<std::vector<std::string>> current_map;
 
     std::vector<std::tuple<std::string, int>> levels = {
         {"1 - Basic Movement.csv", 0},
@@ -67,4 +111,26 @@ private:
 
     // map of tile entities
     std::vector<std::vector<Tile>> tile_map;
-};
\ No newline at end of file
+
+    // walkable layout the current map_version was assigned to
+    std::vector<std::vector<Tile>> versioned_tile_map;
+    uint32_t map_version = 0;
+
+    // patrol routes are requested again on every restart
+    PathCache path_cache;
+
+    // abstract graph for maps larger than one screen, rebuilt with map_version
+    HierarchicalPathfinder hpa;
+
+    // teleport edges, independent of map_version so cached walking paths stay valid
+    PortalGraph portal_graph;
+    uint32_t portal_version = 0;
+
+    DistanceField distance_field;
+
+    // walls and locked doors of the current map, for the distance field
+    std::vector<ivec2> obstacle_cells;
+
+    int map_width = 0;
+    int map_height = 0;
+};
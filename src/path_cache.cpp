@@ -0,0 +1,126 @@
+#include "path_cache.hpp"
+
+namespace {
+    // direction codes match the Direction enum: TOP, RIGHT, BOTTOM, LEFT
+    const ivec2 DIRECTION_STEPS[4] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0} };
+
+    int directionCode(ivec2 from, ivec2 to) {
+        ivec2 delta = to - from;
+        for (int code = 0; code < 4; code++) {
+            if (delta == DIRECTION_STEPS[code])
+                return code;
+        }
+        return -1;
+    }
+
+    uint32_t packedBytes(uint32_t steps) {
+        return (steps + 3) / 4;
+    }
+}
+
+PathCache::PathCache(size_t capacity) : capacity(capacity) {
+}
+
+bool PathCache::lookup(ivec2 start, ivec2 goal, uint32_t map_version, std::vector<ivec2>& out_path) {
+    // a newer map makes every cached path stale
+    if (map_version != current_version) {
+        invalidate();
+        current_version = map_version;
+    }
+
+    auto it = entries.find({start, goal, map_version});
+    if (it == entries.end()) {
+        miss_count++;
+        return false;
+    }
+    hit_count++;
+
+    // move to the front of the LRU list
+    lru.splice(lru.begin(), lru, it->second);
+    const Entry& entry = *it->second;
+
+    out_path.clear();
+    if (!entry.found)
+        return true;
+
+    out_path.reserve(entry.steps + 1);
+    ivec2 cell = entry.first;
+    out_path.push_back(cell);
+    for (uint32_t i = 0; i < entry.steps; i++) {
+        uint8_t byte = arena[entry.offset + i / 4];
+        int code = (byte >> ((i % 4) * 2)) & 0x3;
+        cell += DIRECTION_STEPS[code];
+        out_path.push_back(cell);
+    }
+    return true;
+}
+
+bool PathCache::store(ivec2 start, ivec2 goal, uint32_t map_version, const std::vector<ivec2>& path) {
+    if (map_version != current_version) {
+        invalidate();
+        current_version = map_version;
+    }
+
+    Key key = {start, goal, map_version};
+    if (entries.find(key) != entries.end())
+        return true;
+
+    uint32_t steps = path.empty() ? 0 : (uint32_t)path.size() - 1;
+    for (uint32_t i = 0; i < steps; i++) {
+        if (directionCode(path[i], path[i + 1]) < 0)
+            return false;
+    }
+
+    if (capacity == 0)
+        return false;
+    while (lru.size() >= capacity)
+        evictOldest();
+
+    // reclaim space left behind by evicted paths once it dominates the arena
+    if (arena.size() > 1024 && arena.size() > 2 * live_bytes)
+        compactArena();
+
+    Entry entry;
+    entry.key = key;
+    entry.first = path.empty() ? start : path[0];
+    entry.offset = (uint32_t)arena.size();
+    entry.steps = steps;
+    entry.found = !path.empty();
+
+    arena.resize(arena.size() + packedBytes(steps), 0);
+    for (uint32_t i = 0; i < steps; i++) {
+        int code = directionCode(path[i], path[i + 1]);
+        arena[entry.offset + i / 4] |= (uint8_t)(code << ((i % 4) * 2));
+    }
+    live_bytes += packedBytes(steps);
+
+    lru.push_front(entry);
+    entries[key] = lru.begin();
+    return true;
+}
+
+void PathCache::invalidate() {
+    lru.clear();
+    entries.clear();
+    arena.clear();
+    live_bytes = 0;
+}
+
+void PathCache::evictOldest() {
+    const Entry& oldest = lru.back();
+    live_bytes -= packedBytes(oldest.steps);
+    entries.erase(oldest.key);
+    lru.pop_back();
+}
+
+void PathCache::compactArena() {
+    std::vector<uint8_t> compacted;
+    compacted.reserve(live_bytes);
+    for (Entry& entry : lru) {
+        uint32_t bytes = packedBytes(entry.steps);
+        uint32_t offset = (uint32_t)compacted.size();
+        compacted.insert(compacted.end(), arena.begin() + entry.offset, arena.begin() + entry.offset + bytes);
+        entry.offset = offset;
+    }
+    arena.swap(compacted);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+
+// LRU cache of grid paths keyed by (start cell, goal cell, map version).
+// Each path is stored as its first cell followed by one 2-bit direction code per
+// step (same encoding as the Direction enum), packed into a shared byte arena.
+// A lookup with a newer map version drops every entry at once.
+class PathCache {
+public:
+    explicit PathCache(size_t capacity = 64);
+
+    // returns true and fills out_path (same order as it was stored) on a hit
+    bool lookup(ivec2 start, ivec2 goal, uint32_t map_version, std::vector<ivec2>& out_path);
+
+    // stores a path; returns false if it is not a chain of 4-neighbour steps
+    bool store(ivec2 start, ivec2 goal, uint32_t map_version, const std::vector<ivec2>& path);
+
+    // drop every cached path
+    void invalidate();
+
+    uint64_t hits() const { return hit_count; }
+    uint64_t misses() const { return miss_count; }
+    size_t size() const { return lru.size(); }
+    size_t arenaBytes() const { return arena.size(); }
+
+private:
+    struct Key {
+        ivec2 start;
+        ivec2 goal;
+        uint32_t version;
+
+        bool operator==(const Key& other) const {
+            return start == other.start && goal == other.goal && version == other.version;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            std::size_t h = std::hash<int>()(key.start.x);
+            h = h * 31 + std::hash<int>()(key.start.y);
+            h = h * 31 + std::hash<int>()(key.goal.x);
+            h = h * 31 + std::hash<int>()(key.goal.y);
+            return h * 31 + std::hash<uint32_t>()(key.version);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        ivec2 first;      // first cell of the stored path
+        uint32_t offset;  // byte offset of the direction codes in the arena
+        uint32_t steps;   // number of direction codes
+        bool found;       // false if A* found no path (cached as an empty result)
+    };
+
+    void evictOldest();
+    void compactArena();
+
+    size_t capacity;
+    uint32_t current_version = 0;
+
+    std::list<Entry> lru; // most recently used at the front
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+
+    std::vector<uint8_t> arena;
+    size_t live_bytes = 0;
+
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+};
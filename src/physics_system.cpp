@@ -3,8 +3,16 @@
 #include "world_init.hpp"
 #include <glm/geometric.hpp>
 #include <iostream>
-#include "tinyECS/registry.hpp"
-#include "world_system.hpp"
+#include "util/frame_arena.hpp"
+#include "util/job_system.hpp"
+#include "util/logger.hpp"
+#include "util/perf_counters.hpp"
+#include "util/profiler.hpp"
+#include "world.hpp"
+
+// outer-loop entities per broad phase job; later rows test fewer pairs, so chunks stay
+// small enough for the workers to even out
+const int BROADPHASE_CHUNK = 32;
 
 // Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Motion& motion)
@@ -14,19 +22,19 @@ vec2 get_bounding_box(const Motion& motion)
 }
 
 // debug purposes
-void drawDebugPolygon(const std::vector<vec2>& points, vec3 color = {1, 0, 0})
+void drawDebugPolygon(World& world, const std::vector<vec2>& points, vec3 color = {1, 0, 0})
 {
 	for (size_t i = 0; i < points.size(); ++i) {
 		vec2 start = points[i];
 		vec2 end = points[(i + 1) % points.size()]; 
 
-		entt::entity line = registry.create();
+		entt::entity line = world.registry.create();
 
-		GridLine& grid_line = registry.emplace<GridLine>(line);
+		GridLine& grid_line = world.registry.emplace<GridLine>(line);
 		grid_line.start_pos = start;
 		grid_line.end_pos = end;
 
-		registry.emplace<RenderRequest>(
+		world.registry.emplace<RenderRequest>(
 			line,
 			TEXTURE_ASSET_ID::TEXTURE_COUNT,
 			EFFECT_ASSET_ID::EGG,
@@ -34,18 +42,18 @@ void drawDebugPolygon(const std::vector<vec2>& points, vec3 color = {1, 0, 0})
 			99 
 		);
 
-		registry.emplace<Color>(line, color);
+		world.registry.emplace<Color>(line, color);
 	}
 }
 
 // debug purposes
-void drawMeshOutline(entt::entity entity, vec3 color = {0, 1, 0})
+void drawMeshOutline(World& world, entt::entity entity, vec3 color = {0, 1, 0})
 {
-    if (!registry.all_of<MeshPtr, Motion>(entity))
+    if (!world.registry.all_of<MeshPtr, Motion>(entity))
         return;
 
-    const Mesh& mesh = *registry.get<MeshPtr>(entity);
-    const Motion& motion = registry.get<Motion>(entity);
+    const Mesh& mesh = *world.registry.get<MeshPtr>(entity);
+    const Motion& motion = world.registry.get<Motion>(entity);
 
     float angle = motion.angle * 3.14159265359f / 180.0f;
     mat2 rotation = {
@@ -59,16 +67,16 @@ void drawMeshOutline(entt::entity entity, vec3 color = {0, 1, 0})
         vec2 local = vec2(v.position);          
         vec2 scaled = local * motion.scale;     
         vec2 rotated = rotation * scaled;       
-        vec2 world = rotated + motion.position; 
+        vec2 world_pos = rotated + motion.position; 
 
-        transformed.push_back(world);
+        transformed.push_back(world_pos);
     }
 
-    drawDebugPolygon(transformed, color);
+    drawDebugPolygon(world, transformed, color);
 }
 
 // debug purposes
-void drawAABB(const Motion& motion, vec3 color = {1, 0, 0})
+void drawAABB(World& world, const Motion& motion, vec3 color = {1, 0, 0})
 {
 	vec2 pos = motion.position;
 	vec2 half = get_bounding_box(motion) / 2.f;
@@ -80,7 +88,7 @@ void drawAABB(const Motion& motion, vec3 color = {1, 0, 0})
 		pos + vec2{-half.x,  half.y},
 	};
 
-	drawDebugPolygon(box, color);
+	drawDebugPolygon(world, box, color);
 }
 
 bool boundingBoxOverlap(const Motion& motion1, const Motion& motion2)
@@ -98,22 +106,26 @@ bool boundingBoxOverlap(const Motion& motion1, const Motion& motion2)
     return overlapX && overlapY;
 }
 
-bool collides(entt::entity entity1, entt::entity entity2)
+bool collides(World& world, entt::entity entity1, entt::entity entity2)
 {
-    if (!registry.all_of<Motion, MeshPtr>(entity1) || !registry.all_of<Motion, MeshPtr>(entity2))
+    if (!world.registry.all_of<Motion, MeshPtr>(entity1) || !world.registry.all_of<Motion, MeshPtr>(entity2))
         return false;
 
-    const Motion& motion1 = registry.get<Motion>(entity1);
-    const Motion& motion2 = registry.get<Motion>(entity2);
+    const Motion& motion1 = world.registry.get<Motion>(entity1);
+    const Motion& motion2 = world.registry.get<Motion>(entity2);
+
+    const Mesh& mesh1 = *world.registry.get<MeshPtr>(entity1);
+    const Mesh& mesh2 = *world.registry.get<MeshPtr>(entity2);
 
-    const Mesh& mesh1 = *registry.get<MeshPtr>(entity1);
-    const Mesh& mesh2 = *registry.get<MeshPtr>(entity2);
+    // drawMeshOutline(world, entity1, vec3(0,1,0)); 
+    // drawMeshOutline(world, entity2, vec3(1,0,0));
 
-    // drawMeshOutline(entity1, vec3(0,1,0)); 
-    // drawMeshOutline(entity2, vec3(1,0,0));
+    // the transformed vertices only live for this test
+    FrameArenaScope arena_scope;
 
-    auto transformVerts = [](const Mesh& mesh, const Motion& motion) -> std::vector<vec2> {
-        std::vector<vec2> out;
+    auto transformVerts = [](const Mesh& mesh, const Motion& motion) -> FrameVector<vec2> {
+        FrameVector<vec2> out;
+        out.reserve(mesh.vertices.size());
         float angle = motion.angle * 3.14159265359f / 180.0f;
         mat2 rot = {
             {cos(angle), -sin(angle)},
@@ -130,10 +142,10 @@ bool collides(entt::entity entity1, entt::entity entity2)
         return out;
     };
 
-    std::vector<vec2> verts1 = transformVerts(mesh1, motion1);
-    std::vector<vec2> verts2 = transformVerts(mesh2, motion2);
+    FrameVector<vec2> verts1 = transformVerts(mesh1, motion1);
+    FrameVector<vec2> verts2 = transformVerts(mesh2, motion2);
 
-    auto pointInPolygon = [](const vec2& p, const std::vector<vec2>& poly) -> bool {
+    auto pointInPolygon = [](const vec2& p, const FrameVector<vec2>& poly) -> bool {
         int count = 0;
         for (size_t i = 0; i < poly.size(); ++i) {
             vec2 a = poly[i];
@@ -194,20 +206,20 @@ glm::vec2 getBezierVelocity(const Boomerang& path, float t) {
            3.0f * t2 * (path.end_pos - path.end_control);
 }
 
-bool isNearPortal(entt::entity entity, entt::entity portal)
+bool isNearPortal(World& world, entt::entity entity, entt::entity portal)
 {
-    if (!registry.all_of<Motion>(entity) || !registry.all_of<Motion, Portal>(portal))
+    if (!world.registry.all_of<Motion>(entity) || !world.registry.all_of<Motion, Portal>(portal))
         return false;
 
-    const Motion& entity_motion = registry.get<Motion>(entity);
-    const Portal& portal_data = registry.get<Portal>(portal);
+    const Motion& entity_motion = world.registry.get<Motion>(entity);
+    const Portal& portal_data = world.registry.get<Portal>(portal);
     
     // Calculate distance between entity center and portal center
     vec2 entity_pos = entity_motion.position;
     vec2 portal_pos = portal_data.position;
     
-    std::cout << "Portal Data position:" << portal_pos.x << "," << portal_pos.y << std::endl;
-    std::cout << "Player position:" << entity_pos.x << "," << entity_pos.y << std::endl;
+    LOG_TRACE("Portal Data position: %.1f,%.1f", portal_pos.x, portal_pos.y);
+    LOG_TRACE("Player position: %.1f,%.1f", entity_pos.x, entity_pos.y);
 
     vec2 diff = entity_pos - portal_pos;
     float distance = 0;
@@ -220,44 +232,44 @@ bool isNearPortal(entt::entity entity, entt::entity portal)
 
 
 // Add this new function to check all portals
-void checkPortalProximity()
+void checkPortalProximity(World& world)
 {
     // Initialize as false at the beginning of the function
-    WorldSystem::can_teleport = false;
-    WorldSystem::nearby_player_entity = entt::null;
-    WorldSystem::nearby_wall_entity = entt::null;
+    world.can_teleport = false;
+    world.nearby_player_entity = entt::null;
+    world.nearby_wall_entity = entt::null;
     
     // Get all portals
-    auto portal_view = registry.view<Portal, Motion>();
+    auto portal_view = world.registry.view<Portal, Motion>();
     
     // Check against all players that can interact with portals
-    auto entities = registry.view<Player>();
+    auto entities = world.registry.view<Player>();
     
     for (auto entity : entities)
     {
         // Only check players
-        if (!registry.all_of<Player>(entity))
+        if (!world.registry.all_of<Player>(entity))
             continue;
             
         for (auto portal : portal_view)
         {
-            Portal& portal_data = registry.get<Portal>(portal);
+            Portal& portal_data = world.registry.get<Portal>(portal);
             
             // If player is near this portal
-            if (isNearPortal(entity, portal))
+            if (isNearPortal(world, entity, portal))
             {
                 // Set the static variables to enable teleportation
-                WorldSystem::can_teleport = true;
-                WorldSystem::nearby_player_entity = entity;
+                world.can_teleport = true;
+                world.nearby_player_entity = entity;
                 
                 // Find the corresponding wall
-                auto wall_view = registry.view<Wall>();
+                auto wall_view = world.registry.view<Wall>();
                 for (auto wall : wall_view) {
-                    Wall& wall_data = registry.get<Wall>(wall);
-                    Motion& wall_motion = registry.get<Motion>(wall);
+                    Wall& wall_data = world.registry.get<Wall>(wall);
+                    Motion& wall_motion = world.registry.get<Motion>(wall);
                     
                     if (wall_motion.position == portal_data.position && wall_data.has_portal) {
-                        WorldSystem::nearby_wall_entity = wall;
+                        world.nearby_wall_entity = wall;
                         // Once we found a valid portal/wall combination, we can stop searching
                         return;
                     }
@@ -273,17 +285,17 @@ void PhysicsSystem::step(float elapsed_ms)
 	// Move each entity that has motion (invaders, projectiles, and even towers [they have 0 for velocity])
 	// based on how much time has passed, this is to (partially) avoid
 	// having entities move at different speed based on the machine.
-	auto motion_view = registry.view<Motion>();
+	auto motion_view = world.registry.view<Motion>();
 	for (auto motion_entity : motion_view)
 	{
 		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 		// !!! TODO A1: update motion.position based on step_seconds and motion.velocity [DONE]
 		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		Motion& motion = registry.get<Motion>(motion_entity);
+		Motion& motion = world.registry.get<Motion>(motion_entity);
 		float step_seconds = elapsed_ms / 1000.f;
 
-        if (registry.all_of<Boomerang>(motion_entity)) {
-            Boomerang& path = registry.get<Boomerang>(motion_entity);
+        if (world.registry.all_of<Boomerang>(motion_entity)) {
+            Boomerang& path = world.registry.get<Boomerang>(motion_entity);
             
             // Update elapsed time
             path.elapsed += elapsed_ms;
@@ -318,53 +330,76 @@ void PhysicsSystem::step(float elapsed_ms)
 	}
 
 	// check for collisions between all moving entities
-	auto it_i = motion_view.begin();
-    for (it_i; it_i != motion_view.end(); ++it_i)
+    // floors never collide, so they are left out of the pair loop up front
+    colliders.clear();
+    for (auto entity : motion_view)
     {
-        bool isMouseTrap = false;
-        bool isWall = false;
-
-        entt::entity entity_i = *it_i;
-        if (registry.all_of<Floor>(entity_i))
-            continue; 
-
-        if (registry.all_of<Wall>(entity_i))
-            isWall = true;
-        
-        if (registry.all_of<Mousetrap>(entity_i))
-            isMouseTrap = true;
-        
-        for (auto it_j = std::next(it_i); it_j != motion_view.end(); ++it_j)
-        {   
-            entt::entity entity_j = *it_j;
-            if (registry.all_of<Floor>(entity_j))
-                continue; 
-
-            if ((registry.all_of<Wall>(entity_j) || registry.all_of<Mousetrap>(entity_j)) && (isMouseTrap || isWall)) {
-                continue;
-            }
+        if (world.registry.all_of<Floor>(entity))
+            continue;
+        bool is_static = world.registry.all_of<Wall>(entity) || world.registry.all_of<Mousetrap>(entity);
+        colliders.push_back({ entity, &world.registry.get<Motion>(entity), is_static });
+    }
+
+    // the pair loop runs on the job system; jobs only read the registry, so every pool
+    // they look up must exist before they start
+    world.registry.storage<MeshPtr>();
+    world.registry.storage<WeaponIndicator>();
+
+    int collider_count = (int)colliders.size();
+    int chunk_count = (collider_count + BROADPHASE_CHUNK - 1) / BROADPHASE_CHUNK;
+    if ((int)chunk_collisions.size() < chunk_count)
+        chunk_collisions.resize(chunk_count);
 
-            // check AABB overlap (optimization)
-            Motion& motion_i = registry.get<Motion>(entity_i);
-            Motion& motion_j = registry.get<Motion>(entity_j);
-            if (!boundingBoxOverlap(motion_i, motion_j)) 
-                continue; 
+    JobSystem::shared().parallelFor(collider_count, BROADPHASE_CHUNK, [this, collider_count](int begin, int end) {
+        PROFILE_SCOPE("broadphase_chunk");
+        std::vector<CollisionPair>& found = chunk_collisions[begin / BROADPHASE_CHUNK];
+        found.clear();
+        uint64_t pairs_tested = 0;
+        uint64_t narrowphase_tests = 0;
 
-            // mesh collision
-            if (collides(entity_i, entity_j))
+        for (int i = begin; i < end; i++)
+        {
+            const Collider& collider_i = colliders[i];
+            for (int j = i + 1; j < collider_count; j++)
             {
-                if (!registry.all_of<WeaponIndicator>(entity_i) && !registry.all_of<WeaponIndicator>(entity_j)) {
-                    entt::entity collision = registry.create();
-                    registry.emplace<Collision>(collision, entity_i, entity_j);
+                const Collider& collider_j = colliders[j];
+                if (collider_i.is_static && collider_j.is_static)
+                    continue;
+
+                // check AABB overlap (optimization)
+                pairs_tested++;
+                if (!boundingBoxOverlap(*collider_i.motion, *collider_j.motion))
+                    continue;
+
+                // mesh collision
+                narrowphase_tests++;
+                if (collides(world, collider_i.entity, collider_j.entity))
+                {
+                    if (!world.registry.all_of<WeaponIndicator>(collider_i.entity) && !world.registry.all_of<WeaponIndicator>(collider_j.entity))
+                        found.emplace_back(collider_i.entity, collider_j.entity);
                 }
             }
         }
+
+        PerfCounters::add(PerfCounter::PHYSICS_PAIRS_TESTED, pairs_tested);
+        PerfCounters::add(PerfCounter::PHYSICS_NARROWPHASE, narrowphase_tests);
+    });
+
+    // collision entities are created here, in chunk order, so they come out in the same
+    // order as a serial pass
+    for (int chunk = 0; chunk < chunk_count; chunk++)
+    {
+        for (CollisionPair& pair : chunk_collisions[chunk])
+        {
+            entt::entity collision = world.registry.create();
+            world.registry.emplace<Collision>(collision, pair.first, pair.second);
+        }
     }
 
     // Only check Portal proximity if there is one made
-    auto portal_view = registry.view<Portal>();
+    auto portal_view = world.registry.view<Portal>();
     if (portal_view.size() > 0) {
-        checkPortalProximity();
+        checkPortalProximity(world);
     }
 
 }
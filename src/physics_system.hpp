@@ -2,6 +2,13 @@
 
 #include "common.hpp"
 #include "tinyECS/components.hpp"
+#include "world.hpp"
+
+#include <utility>
+#include <vector>
+
+// mesh-vs-mesh test used by the broad phase in PhysicsSystem::step (after the AABB check)
+bool collides(World& world, entt::entity entity1, entt::entity entity2);
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -9,7 +16,21 @@ class PhysicsSystem
 public:
 	void step(float elapsed_ms);
 
-	PhysicsSystem()
+	explicit PhysicsSystem(World& world) : world(world)
 	{
 	}
+
+private:
+	World& world;
+
+	// broad phase scratch, kept across frames so the buffers are reused
+	struct Collider {
+		entt::entity entity;
+		Motion* motion;
+		bool is_static; // walls and mousetraps never collide with each other
+	};
+	using CollisionPair = std::pair<entt::entity, entt::entity>;
+
+	std::vector<Collider> colliders;
+	std::vector<std::vector<CollisionPair>> chunk_collisions;
 };
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include "portal_graph.hpp"
+#include "tinyECS/registry.hpp"
+
+namespace {
+    const ivec2 NEIGHBOUR_STEPS[4] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0} };
+    const int NO_ROUTE = std::numeric_limits<int>::max() / 4;
+
+    // teleporting counts as a single step
+    const int TELEPORT_COST = 1;
+
+    bool isWalkable(const std::vector<std::vector<Tile>>& tile_map, ivec2 cell) {
+        if (cell.y < 0 || cell.y >= (int)tile_map.size())
+            return false;
+        if (cell.x < 0 || cell.x >= (int)tile_map[cell.y].size())
+            return false;
+        return tile_map[cell.y][cell.x].walkable;
+    }
+}
+
+void PortalGraph::clear() {
+    exits.clear();
+    exit_distance.clear();
+    route_cost.clear();
+    next_hop.clear();
+}
+
+void PortalGraph::rebuild(entt::registry& registry, const std::vector<std::vector<Tile>>& tile_map) {
+    clear();
+
+    map_height = (int)tile_map.size();
+    map_width = 0;
+    for (const auto& row : tile_map)
+        map_width = std::max(map_width, (int)row.size());
+
+    // portals sit on walls; the player leaves through the cell the portal faces
+    std::unordered_map<entt::entity, int> exit_of_portal;
+    auto portal_view = registry.view<Portal>();
+    for (entt::entity portal_entity : portal_view) {
+        Portal& portal = registry.get<Portal>(portal_entity);
+        ivec2 wall_cell = { (int)(portal.position.x / GRID_CELL_WIDTH_PX), (int)(portal.position.y / GRID_CELL_HEIGHT_PX) };
+        ivec2 exit_cell = wall_cell + NEIGHBOUR_STEPS[portal.direction];
+        if (!isWalkable(tile_map, exit_cell))
+            continue;
+
+        exit_of_portal[portal_entity] = (int)exits.size();
+        exits.push_back({exit_cell, -1});
+    }
+
+    for (entt::entity portal_entity : portal_view) {
+        auto it = exit_of_portal.find(portal_entity);
+        if (it == exit_of_portal.end())
+            continue;
+
+        Portal& portal = registry.get<Portal>(portal_entity);
+        if (!registry.valid(portal.other_portal) || !registry.all_of<Portal>(portal.other_portal))
+            continue;
+
+        auto other = exit_of_portal.find(portal.other_portal);
+        if (other != exit_of_portal.end())
+            exits[it->second].partner = other->second;
+    }
+
+    // walking distance from every cell to each exit
+    exit_distance.resize(exits.size());
+    std::vector<ivec2> queue;
+    queue.reserve(map_width * map_height);
+    for (size_t i = 0; i < exits.size(); i++) {
+        std::vector<int>& distance = exit_distance[i];
+        distance.assign(map_width * map_height, -1);
+
+        queue.clear();
+        queue.push_back(exits[i].cell);
+        distance[exits[i].cell.y * map_width + exits[i].cell.x] = 0;
+
+        for (size_t head = 0; head < queue.size(); head++) {
+            ivec2 cell = queue[head];
+            int cell_distance = distance[cell.y * map_width + cell.x];
+            for (const ivec2& step : NEIGHBOUR_STEPS) {
+                ivec2 next = cell + step;
+                if (!isWalkable(tile_map, next))
+                    continue;
+                int& next_distance = distance[next.y * map_width + next.x];
+                if (next_distance >= 0)
+                    continue;
+                next_distance = cell_distance + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // exit-to-exit table (Floyd-Warshall over walking and teleport edges)
+    const int count = (int)exits.size();
+    route_cost.assign(count * count, NO_ROUTE);
+    next_hop.assign(count * count, -1);
+    for (int from = 0; from < count; from++) {
+        for (int to = 0; to < count; to++) {
+            int walk = distanceTo(to, exits[from].cell);
+            if (walk >= 0) {
+                route_cost[from * count + to] = walk;
+                next_hop[from * count + to] = to;
+            }
+        }
+        int partner = exits[from].partner;
+        if (partner >= 0 && TELEPORT_COST < route_cost[from * count + partner]) {
+            route_cost[from * count + partner] = TELEPORT_COST;
+            next_hop[from * count + partner] = partner;
+        }
+    }
+
+    for (int mid = 0; mid < count; mid++) {
+        for (int from = 0; from < count; from++) {
+            int first_leg = route_cost[from * count + mid];
+            if (first_leg >= NO_ROUTE)
+                continue;
+            for (int to = 0; to < count; to++) {
+                int cost = first_leg + route_cost[mid * count + to];
+                if (cost < route_cost[from * count + to]) {
+                    route_cost[from * count + to] = cost;
+                    next_hop[from * count + to] = next_hop[from * count + mid];
+                }
+            }
+        }
+    }
+}
+
+int PortalGraph::distanceTo(int exit, ivec2 cell) const {
+    if (cell.x < 0 || cell.y < 0 || cell.x >= map_width || cell.y >= map_height)
+        return -1;
+    return exit_distance[exit][cell.y * map_width + cell.x];
+}
+
+// walk to exit `first`, teleport to its partner, follow the table to exit `last`, walk to goal
+void PortalGraph::bestRoute(ivec2 start, ivec2 goal, int& cost, int& first, int& last) const {
+    const int count = (int)exits.size();
+    cost = NO_ROUTE;
+    first = -1;
+    last = -1;
+
+    for (int enter = 0; enter < count; enter++) {
+        int partner = exits[enter].partner;
+        int to_portal = distanceTo(enter, start);
+        if (partner < 0 || to_portal < 0)
+            continue;
+
+        for (int leave = 0; leave < count; leave++) {
+            int through = route_cost[partner * count + leave];
+            int to_goal = distanceTo(leave, goal);
+            if (through >= NO_ROUTE || to_goal < 0)
+                continue;
+
+            int total = to_portal + TELEPORT_COST + through + to_goal;
+            if (total < cost) {
+                cost = total;
+                first = enter;
+                last = leave;
+            }
+        }
+    }
+}
+
+int PortalGraph::routeCost(ivec2 start, ivec2 goal) const {
+    int cost, first, last;
+    bestRoute(start, goal, cost, first, last);
+    return first < 0 ? -1 : cost;
+}
+
+void PortalGraph::walkTo(int exit, ivec2 cell, std::vector<PathStep>& out_cells) const {
+    int distance = distanceTo(exit, cell);
+    while (distance > 0) {
+        for (const ivec2& step : NEIGHBOUR_STEPS) {
+            ivec2 next = cell + step;
+            if (distanceTo(exit, next) == distance - 1) {
+                cell = next;
+                break;
+            }
+        }
+        distance--;
+        out_cells.push_back({cell, false});
+    }
+}
+
+bool PortalGraph::findRoute(ivec2 start, ivec2 goal, std::vector<PathStep>& out_path) const {
+    out_path.clear();
+
+    int cost, first, last;
+    bestRoute(start, goal, cost, first, last);
+    if (first < 0)
+        return false;
+
+    const int count = (int)exits.size();
+    out_path.reserve(cost + 1);
+    out_path.push_back({start, false});
+    walkTo(first, start, out_path);
+
+    // teleport, then replay the table hop by hop
+    int at = exits[first].partner;
+    out_path.push_back({exits[at].cell, true});
+    while (at != last) {
+        int hop = next_hop[at * count + last];
+        if (hop == exits[at].partner)
+            out_path.push_back({exits[hop].cell, true});
+        else
+            walkTo(hop, exits[at].cell, out_path);
+        at = hop;
+    }
+
+    // the last leg is walked backwards from the goal
+    std::vector<PathStep> tail;
+    tail.push_back({goal, false});
+    walkTo(last, goal, tail);
+    tail.pop_back();
+    out_path.insert(out_path.end(), tail.rbegin(), tail.rend());
+    return true;
+}
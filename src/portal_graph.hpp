@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+// Teleport edges for grid pathfinding.
+// Every placed portal has an exit cell (the walkable cell in front of the wall it sits on).
+// For each exit a walking-distance field over the whole grid is cached, together with a
+// shortest exit-to-exit table that already folds in chains of teleports. A query through
+// any number of portal pairs is then a scan over exit pairs instead of a new grid search.
+// Rebuild whenever portals are created or removed.
+class PortalGraph {
+public:
+    // read the current Portal entities and recompute every table
+    void rebuild(entt::registry& registry, const std::vector<std::vector<Tile>>& tile_map);
+
+    void clear();
+
+    // cheapest cost from start to goal that uses at least one teleport; -1 if there is none
+    int routeCost(ivec2 start, ivec2 goal) const;
+
+    // path ordered start to goal for the routeCost route; the exit cell of every teleport
+    // is marked, since it is not a neighbour of the cell before it
+    bool findRoute(ivec2 start, ivec2 goal, std::vector<PathStep>& out_path) const;
+
+    size_t exitCount() const { return exits.size(); }
+
+private:
+    struct PortalExit {
+        ivec2 cell;
+        int partner; // index of the linked exit, -1 while the portal is unpaired
+    };
+
+    int distanceTo(int exit, ivec2 cell) const;
+    void bestRoute(ivec2 start, ivec2 goal, int& cost, int& first, int& last) const;
+
+    // walk downhill on exit's distance field from cell; appends cells after cell
+    void walkTo(int exit, ivec2 cell, std::vector<PathStep>& out_cells) const;
+
+    int map_width = 0;
+    int map_height = 0;
+
+    std::vector<PortalExit> exits;
+    std::vector<std::vector<int>> exit_distance; // [exit][cell index], -1 if unreachable
+    std::vector<int> route_cost;                 // [from * count + to], walking + teleports
+    std::vector<int> next_hop;                   // [from * count + to], first exit on that route
+};
@@ -6,12 +6,57 @@
 // internal
 #include "render_system.hpp"
 #include "world_system.hpp"
-#include "tinyECS/registry.hpp"
+#include "world.hpp"
+#include "util/perf_counters.hpp"
+#include "util/profiler.hpp"
+
+namespace {
+	// GL calls counted by the perf counters; same signatures as the GL functions
+	void useProgram(GLuint program) {
+		glUseProgram(program);
+		PerfCounters::add(PerfCounter::GL_STATE_CHANGES);
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer) {
+		glBindBuffer(target, buffer);
+		PerfCounters::add(PerfCounter::GL_STATE_CHANGES);
+	}
+
+	void bindTexture(GLenum target, GLuint texture) {
+		glBindTexture(target, texture);
+		PerfCounters::add(PerfCounter::GL_STATE_CHANGES);
+	}
+
+	void bindFramebuffer(GLenum target, GLuint framebuffer) {
+		glBindFramebuffer(target, framebuffer);
+		PerfCounters::add(PerfCounter::GL_STATE_CHANGES);
+	}
+
+	void uniform1f(GLint location, GLfloat value) {
+		glUniform1f(location, value);
+		PerfCounters::add(PerfCounter::GL_UNIFORM_UPLOADS);
+	}
+
+	void uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+		glUniform3fv(location, count, value);
+		PerfCounters::add(PerfCounter::GL_UNIFORM_UPLOADS);
+	}
+
+	void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+		glUniformMatrix3fv(location, count, transpose, value);
+		PerfCounters::add(PerfCounter::GL_UNIFORM_UPLOADS);
+	}
+
+	void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+		glDrawElements(mode, count, type, indices);
+		PerfCounters::add(PerfCounter::GL_DRAW_CALLS);
+	}
+}
 
 void RenderSystem::drawGridLine(entt::entity entity,
 								const mat3& projection) {
 
-	GridLine& gridLine = registry.get<GridLine>(entity);
+	GridLine& gridLine = world.registry.get<GridLine>(entity);
 
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
@@ -20,15 +65,15 @@ void RenderSystem::drawGridLine(entt::entity entity,
 	transform.translate(gridLine.start_pos);
 	transform.scale(gridLine.end_pos);
 
-	assert(registry.all_of<RenderRequest>(entity));
-	const RenderRequest& render_request = registry.get<RenderRequest>(entity);
+	assert(world.registry.all_of<RenderRequest>(entity));
+	const RenderRequest& render_request = world.registry.get<RenderRequest>(entity);
 
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
 
 	// setting shaders
-	glUseProgram(program);
+	useProgram(program);
 	gl_has_errors();
 
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
@@ -36,10 +81,10 @@ void RenderSystem::drawGridLine(entt::entity entity,
 	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	bindBuffer(GL_ARRAY_BUFFER, vbo);
 	gl_has_errors();
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	gl_has_errors();
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::EGG)
@@ -67,9 +112,9 @@ void RenderSystem::drawGridLine(entt::entity entity,
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.all_of<Color>(entity) ? registry.get<Color>(entity) : vec3(1);
+	const vec3 color = world.registry.all_of<Color>(entity) ? world.registry.get<Color>(entity) : vec3(1);
 	// CK: std::cout << "line color: " << color.r << ", " << color.g << ", " << color.b << std::endl;
-	glUniform3fv(color_uloc, 1, (float*)&color);
+	uniform3fv(color_uloc, 1, (float*)&color);
 	gl_has_errors();
 
 	// Get number of indices from index buffer, which has elements uint16_t
@@ -83,22 +128,22 @@ void RenderSystem::drawGridLine(entt::entity entity,
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
+	uniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
 	gl_has_errors();
 
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+	uniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
 	gl_has_errors();
 
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	drawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
 }
 
 void RenderSystem::drawTexturedMesh(entt::entity entity,
 									const mat3 &projection)
 {
-	Motion &motion = registry.get<Motion>(entity);
+	Motion &motion = world.registry.get<Motion>(entity);
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
 	// thus ORDER IS IMPORTANT
@@ -107,15 +152,15 @@ void RenderSystem::drawTexturedMesh(entt::entity entity,
 	transform.scale(motion.scale);
 	transform.rotate(radians(motion.angle));
 
-	assert(registry.all_of<RenderRequest>(entity));
-	const RenderRequest &render_request = registry.get<RenderRequest>(entity);
+	assert(world.registry.all_of<RenderRequest>(entity));
+	const RenderRequest &render_request = world.registry.get<RenderRequest>(entity);
 
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	useProgram(program);
 	gl_has_errors();
 
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
@@ -123,8 +168,8 @@ void RenderSystem::drawTexturedMesh(entt::entity entity,
 	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	bindBuffer(GL_ARRAY_BUFFER, vbo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	gl_has_errors();
 
 	// texture-mapped entities - use data location as in the vertex buffer
@@ -150,11 +195,11 @@ void RenderSystem::drawTexturedMesh(entt::entity entity,
 		glActiveTexture(GL_TEXTURE0);
 		gl_has_errors();
 
-		assert(registry.all_of<RenderRequest>(entity));
+		assert(world.registry.all_of<RenderRequest>(entity));
 		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.get<RenderRequest>(entity).used_texture];
+			texture_gl_handles[(GLuint)world.registry.get<RenderRequest>(entity).used_texture];
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		bindTexture(GL_TEXTURE_2D, texture_id);
 		gl_has_errors();
 	}
 	// .obj entities
@@ -181,8 +226,8 @@ void RenderSystem::drawTexturedMesh(entt::entity entity,
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.all_of<Color>(entity) ? registry.get<Color>(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	const vec3 color = world.registry.all_of<Color>(entity) ? world.registry.get<Color>(entity) : vec3(1);
+	uniform3fv(color_uloc, 1, (float *)&color);
 	gl_has_errors();
 
 	// Get number of indices from index buffer, which has elements uint16_t
@@ -197,25 +242,25 @@ void RenderSystem::drawTexturedMesh(entt::entity entity,
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
+	uniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
 	gl_has_errors();
 
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
+	uniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
 	gl_has_errors();
 
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	drawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
 }
 
 void RenderSystem::drawText(entt::entity entity, const mat3& projection)
 {
-	TextRenderRequest &render_request = registry.get<TextRenderRequest>(entity);
+	TextRenderRequest &render_request = world.registry.get<TextRenderRequest>(entity);
 	int cur_x = render_request.position.x;
 	int cur_y = render_request.position.y;
 	glm::vec2 scale = render_request.scale;
-	std::string text = render_request.text;
+	const std::string& text = render_request.text;
 
 	for (int i = 0; i < text.length(); i++) {
 		char c = text[i];
@@ -237,15 +282,15 @@ void RenderSystem::drawChar(char c, glm::vec2 pos, glm::vec2 scale, const mat3&
 	const GLuint program = (GLuint)effects[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	useProgram(program);
 	gl_has_errors();
 
 	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	bindBuffer(GL_ARRAY_BUFFER, vbo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	gl_has_errors();
 
 	// texture-mapped entities - use data location as in the vertex buffer
@@ -271,14 +316,14 @@ void RenderSystem::drawChar(char c, glm::vec2 pos, glm::vec2 scale, const mat3&
 
 	GLuint texture_id = characters[c].TextureID;
 
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	bindTexture(GL_TEXTURE_2D, texture_id);
 	gl_has_errors();
 
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "textColor");
 	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	uniform3fv(color_uloc, 1, (float *)&color);
 	gl_has_errors();
 
 	// Get number of indices from index buffer, which has elements uint16_t
@@ -293,15 +338,15 @@ void RenderSystem::drawChar(char c, glm::vec2 pos, glm::vec2 scale, const mat3&
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
+	uniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
 	gl_has_errors();
 
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
+	uniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
 	gl_has_errors();
 
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	drawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
 }
 
@@ -312,13 +357,13 @@ void RenderSystem::drawToScreen()
 {
 	// Setting shaders
 	// get the vignette texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE]);
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE]);
 	gl_has_errors();
 
 	// Clearing backbuffer
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	bindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, w, h);
 	glDepthRange(0, 10);
 	glClearColor(1.f, 0, 0, 1.0);
@@ -331,8 +376,8 @@ void RenderSystem::drawToScreen()
 	glDisable(GL_DEPTH_TEST);
 
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
+	bindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	bindBuffer(
 		GL_ELEMENT_ARRAY_BUFFER,
 		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
 																	 // indices to the bound GL_ARRAY_BUFFER
@@ -345,21 +390,21 @@ void RenderSystem::drawToScreen()
 	GLuint time_uloc       = glGetUniformLocation(vignette_program, "time");
 	GLuint dead_timer_uloc = glGetUniformLocation(vignette_program, "darken_screen_factor");
 
-	float time = (float)(glfwGetTime() * 10.0f);
-	glUniform1f(time_uloc, time);
+	float time = (float)(world.gameTime() * 10.0f);
+	uniform1f(time_uloc, time);
 	
-	ScreenState &screen = registry.get<ScreenState>(screen_state_entity);
+	ScreenState &screen = world.registry.get<ScreenState>(screen_state_entity);
 	if (screen.darken_screen_factor >= 0) {
 		// M1 interpolation implementation
 		// ease-in interpolation for the darken screen effect
-		double a = 0, b = 1, t = 0.1 * ((glfwGetTime() * 10.0f) - death_time);
+		double a = 0, b = 1, t = 0.1 * ((world.gameTime() * 10.0f) - death_time);
 		screen.darken_screen_factor = min(1.0, a + (b - a) * t * t);
 	}
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
+	uniform1f(dead_timer_uloc, screen.darken_screen_factor);
 
 	// VIGNETTE ADDITIONS
 	GLboolean apply_vignette_loc = glGetUniformLocation(vignette_program, "apply_vignette");
-	glUniform1f(apply_vignette_loc, last_invader_tower_collision_time + 5.0 > time); // show vignette for 0.5 seconds
+	uniform1f(apply_vignette_loc, last_invader_tower_collision_time + 5.0 > time); // show vignette for 0.5 seconds
 
 	gl_has_errors();
 
@@ -373,11 +418,11 @@ void RenderSystem::drawToScreen()
 	// Bind our texture in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
 
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
 	gl_has_errors();
 
 	// Draw
-	glDrawElements(
+	drawElements(
 		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 				  // no offset from the bound index buffer
@@ -386,6 +431,23 @@ void RenderSystem::drawToScreen()
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void RenderSystem::build_render_list(std::vector<entt::entity>& out_entities)
+{
+	world.registry.sort<RenderRequest>([](const RenderRequest &lhs, const RenderRequest &rhs) {
+		return lhs.z < rhs.z;
+	});
+
+	out_entities.clear();
+	auto rr_view = world.registry.view<RenderRequest>();
+	for (auto entity : rr_view)
+	{
+		// filter to entities that have a motion component, or are grid lines
+		if (world.registry.all_of<Motion>(entity) || world.registry.all_of<GridLine>(entity)) {
+			out_entities.push_back(entity);
+		}
+	}
+}
+
 void RenderSystem::draw(GAME_SCREEN_ID game_screen)
 {
 	// Getting size of window
@@ -393,7 +455,7 @@ void RenderSystem::draw(GAME_SCREEN_ID game_screen)
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
 	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	bindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
 	gl_has_errors();
 	
 	// clear backbuffer
@@ -414,26 +476,29 @@ void RenderSystem::draw(GAME_SCREEN_ID game_screen)
 
 	mat3 projection_2D = createProjectionMatrix();
 
-	registry.sort<RenderRequest>([](const RenderRequest &lhs, const RenderRequest &rhs) {
-		return lhs.z < rhs.z;
-	});
-	auto rr_view = registry.view<RenderRequest>();
-	for (auto entity : rr_view)
 	{
-		// filter to entities that have a motion component
-		if (registry.all_of<Motion>(entity)) {
+		PROFILE_SCOPE("render_list");
+		build_render_list(render_list);
+	}
+	{
+		PROFILE_SCOPE("draw_meshes");
+		for (auto entity : render_list)
+		{
 			// Note, its not very efficient to access elements indirectly via the entity
 			// albeit iterating through all Sprites in sequence. A good point to optimize
-			drawTexturedMesh(entity, projection_2D);
-		}
-		// draw grid lines separately, as they do not have motion but need to be rendered
-		else if (registry.all_of<GridLine>(entity)) {
-			drawGridLine(entity, projection_2D);
+			if (world.registry.all_of<Motion>(entity)) {
+				drawTexturedMesh(entity, projection_2D);
+			}
+			// draw grid lines separately, as they do not have motion but need to be rendered
+			else {
+				drawGridLine(entity, projection_2D);
+			}
 		}
 	}
 
 	if (game_screen != GAME_SCREEN_ID::CUTSCENE && game_screen != GAME_SCREEN_ID::START_SCREEN) {
-		auto trr_view = registry.view<TextRenderRequest>();
+		PROFILE_SCOPE("draw_text");
+		auto trr_view = world.registry.view<TextRenderRequest>();
 		for (auto entity : trr_view)
 		{
 			drawText(entity, projection_2D);
@@ -443,10 +508,16 @@ void RenderSystem::draw(GAME_SCREEN_ID game_screen)
 
 	// draw framebuffer to screen
 	// adding "vignette" effect when applied
-	drawToScreen();
+	{
+		PROFILE_SCOPE("draw_to_screen");
+		drawToScreen();
+	}
 
 	// flicker-free display with a double buffer
-	glfwSwapBuffers(window);
+	{
+		PROFILE_SCOPE("swap_buffers");
+		glfwSwapBuffers(window);
+	}
 	gl_has_errors();
 }
 
@@ -9,6 +9,7 @@
 #include "common.hpp"
 #include "tinyECS/components.hpp"
 
+class World;
 
 // fonts
 struct Character {
@@ -138,13 +139,21 @@ class RenderSystem {
 	std::array<Mesh, geometry_count> meshes;
 
 	// last invader-tower collision time
-	float last_invader_tower_collision_time = (float)(glfwGetTime() * 10.0f) - 10.0; // initialize to a value before current time
-	float death_time = (float)(glfwGetTime() * 10.0f) - 10.0;
+	float last_invader_tower_collision_time = -10.f; // initialize to a value before the world's clock starts
+	float death_time = -10.f;
 
 public:
+	// draws the entities of world
+	explicit RenderSystem(World& world) : world(world) {}
+
 	// Initialize the window
 	bool init(GLFWwindow* window);
 
+	// no window or GL context: only the screen state and CPU-side meshes (used for collisions)
+	bool init_headless();
+
+	bool is_headless() const { return window == nullptr; }
+
 	void load_font();
 
 	template <class T>
@@ -170,6 +179,9 @@ public:
 	// Draw all entities
 	void draw(GAME_SCREEN_ID game_screen);
 
+	// entities to draw this frame in z order: sprites with a motion, then grid lines in place
+	void build_render_list(std::vector<entt::entity>& out_entities);
+
 	mat3 createProjectionMatrix();
 
 	entt::entity get_screen_state_entity() { return screen_state_entity; }
@@ -186,8 +198,10 @@ private:
 	void drawChar(char c, glm::vec2 pos, glm::vec2 scale, const mat3& projection);
 	void drawToScreen();
 
-	// Window handle
-	GLFWwindow* window;
+	World& world;
+
+	// Window handle, null when headless
+	GLFWwindow* window = nullptr;
 
 	// Screen texture handles
 	GLuint frame_buffer;
@@ -196,6 +210,9 @@ private:
 
 	entt::entity screen_state_entity;
 
+	// reused every frame by draw
+	std::vector<entt::entity> render_list;
+
 	// fonts
 	FT_Library ft;
     FT_Face face;
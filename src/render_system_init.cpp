@@ -7,7 +7,8 @@
 // internal
 #include "../ext/stb_image/stb_image.h"
 #include "render_system.hpp"
-#include "tinyECS/registry.hpp"
+#include "world.hpp"
+#include "util/logger.hpp"
 
 
 // Render initialization
@@ -34,9 +35,9 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	glfwGetFramebufferSize(window, &frame_buffer_width_px, &frame_buffer_height_px);  // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 	if (frame_buffer_width_px != WINDOW_WIDTH_PX)
 	{
-		printf("WARNING: retina display! https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value\n");
-		printf("glfwGetFramebufferSize = %d,%d\n", frame_buffer_width_px, frame_buffer_height_px);
-		printf("requested window width,height = %d,%d\n", WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX);
+		LOG_WARN("retina display! https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value");
+		LOG_WARN("glfwGetFramebufferSize = %d,%d", frame_buffer_width_px, frame_buffer_height_px);
+		LOG_WARN("requested window width,height = %d,%d", WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX);
 	}
 
 	// Hint: Ask your TA for how to setup pretty OpenGL error callbacks. 
@@ -60,17 +61,38 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	return true;
 }
 
+bool RenderSystem::init_headless()
+{
+	screen_state_entity = world.registry.create();
+	world.registry.emplace<ScreenState>(screen_state_entity);
+
+	// collision checks read the mesh vertices, so load them without uploading anything
+	for (uint i = 0; i < mesh_paths.size(); i++)
+	{
+		GEOMETRY_BUFFER_ID geom_index = mesh_paths[i].first;
+		Mesh::loadFromOBJFile(mesh_paths[i].second,
+			meshes[(int)geom_index].vertices,
+			meshes[(int)geom_index].vertex_indices,
+			meshes[(int)geom_index].original_size);
+	}
+
+	return true;
+}
+
 void RenderSystem::load_font() {
+	if (is_headless())
+		return;
+
 	std::string font_filepath = font_path("Kenney_Pixel_Square.ttf");
 
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft)) {
-		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+		LOG_ERROR("FREETYPE: Could not init FreeType Library");
 		// Handle error
 	}
 
 	if (FT_New_Face(ft, font_filepath.c_str(), 0, &face)) {
-		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+		LOG_ERROR("FREETYPE: Failed to load font");
 		// Handle error
 	}
 
@@ -85,7 +107,7 @@ void RenderSystem::load_font() {
 		// load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 		{
-			std::cerr << "ERROR::FREETYTPE: Failed to load Glyph " << c << std::endl;
+			LOG_ERROR("FREETYPE: Failed to load Glyph %d", (int)c);
 			continue;
 		}
 
@@ -140,8 +162,8 @@ void RenderSystem::initializeGlTextures()
 
 		if (data == NULL)
 		{
-			const std::string message = "Could not load the file " + path + ".";
-			fprintf(stderr, "%s", message.c_str());
+			LOG_ERROR("Could not load the file %s.", path.c_str());
+			Logger::flush();
 			assert(false);
 		}
 		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
@@ -292,6 +314,16 @@ void RenderSystem::initializeGlGeometryBuffers()
 
 RenderSystem::~RenderSystem()
 {
+	// remove all entities created by the render system
+	auto view = world.registry.view<RenderRequest>();
+	for (auto entity : view) {
+		world.registry.destroy(entity);
+	}
+
+	// nothing was created on the GPU
+	if (is_headless())
+		return;
+
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
@@ -307,20 +339,14 @@ RenderSystem::~RenderSystem()
 	// delete allocated resources
 	glDeleteFramebuffers(1, &frame_buffer);
 	gl_has_errors();
-
-	// remove all entities created by the render system
-	auto view = registry.view<RenderRequest>();
-	for (auto entity : view) {
-		registry.destroy(entity);
-	}
 }
 
 // Initialize the screen texture from a standard sprite
 bool RenderSystem::initScreenTexture()
 {
 	// create a single entry
-	screen_state_entity = registry.create();
-	registry.emplace<ScreenState>(screen_state_entity);
+	screen_state_entity = world.registry.create();
+	world.registry.emplace<ScreenState>(screen_state_entity);
 
 	int framebuffer_width, framebuffer_height;
 	glfwGetFramebufferSize(const_cast<GLFWwindow*>(window), &framebuffer_width, &framebuffer_height);  // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
@@ -360,7 +386,7 @@ bool gl_compile_shader(GLuint shader)
 
 		gl_has_errors();
 
-		fprintf(stderr, "GLSL: %s", log.data());
+		LOG_ERROR("GLSL: %s", log.data());
 		return false;
 	}
 
@@ -375,7 +401,7 @@ bool loadEffectFromFile(
 	std::ifstream fs_is(fs_path);
 	if (!vs_is.good() || !fs_is.good())
 	{
-		fprintf(stderr, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
+		LOG_ERROR("Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
 		assert(false);
 		return false;
 	}
@@ -400,13 +426,13 @@ bool loadEffectFromFile(
 	// Compiling
 	if (!gl_compile_shader(vertex))
 	{
-		fprintf(stderr, "Vertex compilation failed");
+		LOG_ERROR("Vertex compilation failed");
 		assert(false);
 		return false;
 	}
 	if (!gl_compile_shader(fragment))
 	{
-		fprintf(stderr, "Fragment compilation failed");
+		LOG_ERROR("Fragment compilation failed");
 		assert(false);
 		return false;
 	}
@@ -429,7 +455,7 @@ bool loadEffectFromFile(
 			glGetProgramInfoLog(out_program, log_len, &log_len, log.data());
 			gl_has_errors();
 
-			fprintf(stderr, "Link error: %s", log.data());
+			LOG_ERROR("Link error: %s", log.data());
 			assert(false);
 			return false;
 		}
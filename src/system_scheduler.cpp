@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cassert>
+
+#include "system_scheduler.hpp"
+#include "util/logger.hpp"
+#include "util/profiler.hpp"
+
+namespace {
+    bool overlaps(const std::vector<int>& a, const std::vector<int>& b) {
+        for (int component : a) {
+            if (std::find(b.begin(), b.end(), component) != b.end())
+                return true;
+        }
+        return false;
+    }
+}
+
+SystemScheduler::Builder SystemScheduler::add(const char* name, SystemFn fn) {
+    System system;
+    system.name = name;
+    system.fn = std::move(fn);
+    systems.push_back(std::move(system));
+    built = false;
+    return Builder(this, (int)systems.size() - 1);
+}
+
+uint64_t SystemScheduler::hashBytes(uint64_t hash, const void* data, size_t size) {
+    // FNV-1a
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool SystemScheduler::conflicts(const System& a, const System& b) const {
+    if (a.exclusive || b.exclusive)
+        return true;
+    return overlaps(a.writes, b.reads) || overlaps(a.writes, b.writes) || overlaps(b.writes, a.reads);
+}
+
+// an edge from every earlier system to each later one it conflicts with; registration
+// order is therefore a valid order to run them in
+void SystemScheduler::build() {
+    for (System& system : systems) {
+        system.successors.clear();
+        system.dependency_count = 0;
+    }
+    for (int later = 0; later < (int)systems.size(); later++) {
+        for (int earlier = 0; earlier < later; earlier++) {
+            if (!conflicts(systems[earlier], systems[later]))
+                continue;
+            systems[earlier].successors.push_back(later);
+            systems[later].dependency_count++;
+        }
+    }
+    remaining = std::make_unique<std::atomic<int>[]>(systems.size());
+    built = true;
+
+    for (const System& system : systems) {
+        std::string after;
+        for (int other = 0; other < (int)systems.size(); other++) {
+            const std::vector<int>& next = systems[other].successors;
+            if (std::find(next.begin(), next.end(), int(&system - systems.data())) != next.end())
+                after += std::string(after.empty() ? "" : ", ") + systems[other].name;
+        }
+        LOG_DEBUG("System %s%s runs after: %s", system.name, system.exclusive ? " (exclusive)" : "",
+                  after.empty() ? "-" : after.c_str());
+    }
+}
+
+void SystemScheduler::invoke(int index, float elapsed_ms) {
+    System& system = systems[index];
+    ProfileScope scope(system.name, profile_depth);
+    if (!system.condition || system.condition())
+        system.fn(elapsed_ms);
+}
+
+void SystemScheduler::execute(int index, float elapsed_ms) {
+    invoke(index, elapsed_ms);
+    for (int next : systems[index].successors) {
+        if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            launch(next, elapsed_ms);
+    }
+}
+
+void SystemScheduler::launch(int index, float elapsed_ms) {
+    if (systems[index].exclusive) {
+        // it conflicts with everything, so no other system can be ready or running now
+        int previous = exclusive_ready.exchange(index);
+        assert(previous < 0);
+        (void)previous;
+        return;
+    }
+    JobSystem::shared().run([this, index, elapsed_ms] { execute(index, elapsed_ms); }, &running);
+}
+
+void SystemScheduler::run(float elapsed_ms) {
+    if (!built)
+        build();
+    profile_depth = Profiler::currentDepth();
+
+    if (validate || JobSystem::shared().workerCount() == 0) {
+        runSerial(elapsed_ms);
+        return;
+    }
+
+    for (int i = 0; i < (int)systems.size(); i++)
+        remaining[i].store(systems[i].dependency_count, std::memory_order_relaxed);
+    for (int i = 0; i < (int)systems.size(); i++) {
+        if (systems[i].dependency_count == 0)
+            launch(i, elapsed_ms);
+    }
+
+    // once the jobs in flight are done, either an exclusive system is ready or all have run
+    while (true) {
+        JobSystem::shared().wait(running);
+        int next = exclusive_ready.exchange(-1);
+        if (next < 0)
+            break;
+        execute(next, elapsed_ms);
+    }
+}
+
+void SystemScheduler::runSerial(float elapsed_ms) {
+    std::vector<PoolChecksum> before;
+    for (int i = 0; i < (int)systems.size(); i++) {
+        const System& system = systems[i];
+        bool check = validate && !system.exclusive;
+        if (check)
+            before = checksumPools();
+
+        invoke(i, elapsed_ms);
+
+        if (!check)
+            continue;
+        for (const PoolChecksum& pool : checksumPools()) {
+            if (declaresWrite(system, pool.id))
+                continue;
+            auto previous = std::find_if(before.begin(), before.end(),
+                                         [&](const PoolChecksum& other) { return other.id == pool.id; });
+            if (previous != before.end() && previous->hash == pool.hash)
+                continue;
+            if (!reported.insert({ i, pool.id }).second)
+                continue;
+            LOG_WARN("System %s changed %s without declaring a write", system.name, std::string(pool.name).c_str());
+        }
+    }
+}
+
+std::vector<SystemScheduler::PoolChecksum> SystemScheduler::checksumPools() {
+    std::vector<PoolChecksum> pools;
+    for (auto [id, storage] : registry.storage()) {
+        uint64_t hash = CHECKSUM_SEED;
+        auto checksum = checksums.find(id);
+        if (checksum != checksums.end()) {
+            hash = checksum->second(registry);
+        } else {
+            // type unknown here, so only which entities have it
+            for (entt::entity entity : storage)
+                hash = hashBytes(hash, &entity, sizeof(entity));
+        }
+        pools.push_back({ id, storage.type().name(), hash });
+    }
+    return pools;
+}
+
+bool SystemScheduler::declaresWrite(const System& system, entt::id_type component) const {
+    for (int index : system.writes) {
+        if (component_types[index].id == component)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tinyECS/registry.hpp"
+#include "util/job_system.hpp"
+
+// Runs the per-frame game systems from their declared component access.
+// Each system lists the components it reads and writes. Two systems conflict when one
+// writes a component the other reads or writes, or when either is exclusive. Conflicting
+// systems run in the order they were added; the rest may run at the same time on the job
+// system. A system that creates or destroys entities, adds or removes components, or needs
+// the main thread (GL, audio) must be exclusive: it runs alone, on the calling thread.
+// The pools of declared components are created when the system is added, so a system on
+// a worker must not look up any component it did not declare.
+//
+// With validation on, systems run one at a time and every component storage in the
+// registry is checksummed around each non-exclusive system to catch writes it did not
+// declare. Values are compared for declared plain types and for types passed to watch();
+// for any other storage only the set of entities in it is. Reads cannot be observed and
+// are not checked.
+class SystemScheduler {
+public:
+    using SystemFn = std::function<void(float elapsed_ms)>;
+
+    explicit SystemScheduler(entt::registry& registry) : registry(registry) {}
+
+    // declares the access of the system just added
+    class Builder {
+    public:
+        template <class... T>
+        Builder& reads() {
+            (scheduler->declare<T>(scheduler->systems[index].reads), ...);
+            return *this;
+        }
+
+        template <class... T>
+        Builder& writes() {
+            (scheduler->declare<T>(scheduler->systems[index].writes), ...);
+            return *this;
+        }
+
+        Builder& exclusive() {
+            scheduler->systems[index].exclusive = true;
+            return *this;
+        }
+
+        // skip the system this frame unless condition() holds when it is due to run
+        Builder& runIf(std::function<bool()> condition) {
+            scheduler->systems[index].condition = std::move(condition);
+            return *this;
+        }
+
+    private:
+        friend class SystemScheduler;
+        Builder(SystemScheduler* scheduler, int index) : scheduler(scheduler), index(index) {}
+
+        SystemScheduler* scheduler;
+        int index;
+    };
+
+    // name must be a string literal, it doubles as the profiler scope
+    Builder add(const char* name, SystemFn fn);
+
+    // runs every system once and returns when all are done
+    void run(float elapsed_ms);
+
+    void setValidation(bool enabled) { validate = enabled; }
+    bool validation() const { return validate; }
+
+    // lets validation compare the values of components no system declared
+    template <class... T>
+    SystemScheduler& watch() {
+        (addChecksum<T>([](entt::registry& registry) { return checksumStorage<T>(registry); }), ...);
+        return *this;
+    }
+
+    // for components that are more than plain bytes; hash_value folds one value into hash
+    template <class T>
+    SystemScheduler& watch(uint64_t (*hash_value)(uint64_t hash, const T& value)) {
+        checksums[entt::type_id<T>().hash()] = [hash_value](entt::registry& registry) {
+            uint64_t hash = CHECKSUM_SEED;
+            for (entt::entity entity : registry.view<T>()) {
+                hash = hashBytes(hash, &entity, sizeof(entity));
+                hash = hash_value(hash, registry.get<T>(entity));
+            }
+            return hash;
+        };
+        return *this;
+    }
+
+    // FNV-1a, for watch() value hashers
+    static uint64_t hashBytes(uint64_t hash, const void* data, size_t size);
+
+private:
+    using ChecksumFn = std::function<uint64_t(entt::registry& registry)>;
+
+    struct ComponentType {
+        entt::id_type id;
+        std::string name;
+    };
+
+    struct PoolChecksum {
+        entt::id_type id;
+        std::string_view name;
+        uint64_t hash;
+    };
+
+    struct System {
+        const char* name;
+        SystemFn fn;
+        std::function<bool()> condition;
+        std::vector<int> reads; // indices into component_types
+        std::vector<int> writes;
+        bool exclusive = false;
+
+        // filled in by build()
+        std::vector<int> successors;
+        int dependency_count = 0;
+    };
+
+    template <class T>
+    void declare(std::vector<int>& access) {
+        const entt::type_info& info = entt::type_id<T>();
+        int index = 0;
+        while (index < (int)component_types.size() && component_types[index].id != info.hash())
+            index++;
+        if (index == (int)component_types.size()) {
+            registry.storage<T>();
+            component_types.push_back({ info.hash(), std::string(info.name()) });
+            addChecksum<T>([](entt::registry& registry) { return checksumStorage<T>(registry); });
+        }
+        access.push_back(index);
+        built = false;
+    }
+
+    // entities in the storage plus, where they are plain bytes, the component values
+    template <class T>
+    static uint64_t checksumStorage(entt::registry& registry) {
+        uint64_t hash = CHECKSUM_SEED;
+        for (entt::entity entity : registry.view<T>()) {
+            hash = hashBytes(hash, &entity, sizeof(entity));
+            if constexpr (!std::is_empty_v<T> && std::is_trivially_copyable_v<T>)
+                hash = hashBytes(hash, &registry.get<T>(entity), sizeof(T));
+        }
+        return hash;
+    }
+
+    // keeps a hasher given to watch() over the default one
+    template <class T>
+    void addChecksum(ChecksumFn checksum) {
+        checksums.emplace(entt::type_id<T>().hash(), std::move(checksum));
+    }
+
+    std::vector<PoolChecksum> checksumPools();
+    bool declaresWrite(const System& system, entt::id_type component) const;
+
+    static const uint64_t CHECKSUM_SEED = 14695981039346656037ull;
+
+    bool conflicts(const System& a, const System& b) const;
+    void build();
+    void invoke(int index, float elapsed_ms);
+    void execute(int index, float elapsed_ms);
+    void launch(int index, float elapsed_ms);
+    void runSerial(float elapsed_ms);
+
+    entt::registry& registry;
+    std::vector<System> systems;
+    std::vector<ComponentType> component_types;
+    std::unordered_map<entt::id_type, ChecksumFn> checksums;
+    bool built = false;
+    bool validate = false;
+
+    // per-frame state of a concurrent run
+    std::unique_ptr<std::atomic<int>[]> remaining;
+    std::atomic<int> exclusive_ready{-1};
+    JobCounter running;
+    int profile_depth = 0;
+
+    // (system, component) pairs already reported by validation
+    std::set<std::pair<int, entt::id_type>> reported;
+};
@@ -0,0 +1,24 @@
+#include <algorithm>
+
+#include "command_buffer.hpp"
+
+bool CommandBuffer::destroying(entt::entity entity) const {
+    return std::find(destroyed.begin(), destroyed.end(), entity) != destroyed.end();
+}
+
+void CommandBuffer::playback() {
+    // by index: a command may record further commands, which then run in this playback too
+    for (size_t i = 0; i < commands.size(); i++) {
+        std::function<void()> command = std::move(commands[i]);
+        command();
+    }
+    commands.clear();
+
+    // one pass in entity order instead of a destroy per contact
+    std::sort(destroyed.begin(), destroyed.end());
+    destroyed.erase(std::unique(destroyed.begin(), destroyed.end()), destroyed.end());
+    destroyed.erase(std::remove_if(destroyed.begin(), destroyed.end(),
+        [this](entt::entity entity) { return !registry.valid(entity); }), destroyed.end());
+    registry.destroy(destroyed.begin(), destroyed.end());
+    destroyed.clear();
+}
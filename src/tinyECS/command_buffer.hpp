@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "registry.hpp"
+
+// Structural changes recorded while a system iterates and applied later in one batch.
+// Destroying an entity or creating one in the middle of a view loop either invalidates
+// the loop or hands later code an entity that is gone. Systems record such changes here
+// and call playback() at a point where nothing is iterating.
+//
+// playback() first runs the deferred commands (emplace, remove, defer) in the order they
+// were recorded, then destroys every recorded entity once. Duplicates and entities that
+// are already gone are skipped, so two contacts may both ask for the same projectile.
+class CommandBuffer {
+public:
+    explicit CommandBuffer(entt::registry& registry) : registry(registry) {}
+
+    void destroy(entt::entity entity) { destroyed.push_back(entity); }
+
+    // true if destroy() was recorded for entity since the last playback
+    bool destroying(entt::entity entity) const;
+
+    template <class T, class... Args>
+    void emplace(entt::entity entity, Args... args) {
+        commands.push_back([this, entity, args...]() {
+            if (registry.valid(entity))
+                registry.emplace_or_replace<T>(entity, args...);
+        });
+    }
+
+    template <class T>
+    void remove(entt::entity entity) {
+        commands.push_back([this, entity]() {
+            if (registry.valid(entity))
+                registry.remove<T>(entity);
+        });
+    }
+
+    // any other change, e.g. a world_init create* call, run in order at playback
+    void defer(std::function<void()> command) { commands.push_back(std::move(command)); }
+
+    bool empty() const { return commands.empty() && destroyed.empty(); }
+
+    void playback();
+
+private:
+    entt::registry& registry;
+    std::vector<std::function<void()>> commands;
+    std::vector<entt::entity> destroyed;
+};
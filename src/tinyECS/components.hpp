@@ -200,13 +200,30 @@ struct PortalProximity
 struct Cat {
 };
 
+// one cell of a grid route that may go through portals
+struct PathStep {
+    ivec2 cell;
+    bool teleport = false; // reached by teleporting from the step before it on the route, not by walking
+};
+
 struct Patrol {
     std::vector<vec2> waypoints; // List of patrol points
     int currentTargetIndex = 0; // Index of the current target
-    bool chasing = false; // Flag to check if chasing
     vec2 lastPatrolPos; // Store last patrol position before chasing
     int lastTargetIndex = 0; // Store the patrol waypoint it was heading toward
     bool reversing = false; // Flag to check if reversing patrol path
+    std::vector<PathStep> returnPath; // cells back to lastTargetIndex after a chase, next one last
+    uint32_t returnPortalVersion = 0; // portal layout returnPath was planned for
+};
+
+// patrol cat states; every Patrol has exactly one of these
+struct PatrolWalking {
+};
+
+struct PatrolChasing {
+};
+
+struct PatrolReturning {
 };
 
 struct Sniper {
@@ -214,6 +231,14 @@ struct Sniper {
 	Direction direction;
 };
 
+// AI level of detail, filled in by AIScheduler every frame
+struct AITick {
+	float interval_ms = 0.f;    // desired time between updates (0 = every frame)
+	float accumulated_ms = 0.f; // time since the agent last ran
+	float step_ms = 0.f;        // time to integrate this frame if due
+	bool due = true;
+};
+
 struct Boid {
     float wanderAngle = 0.0f;
 };
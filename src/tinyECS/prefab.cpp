@@ -0,0 +1,62 @@
+#include <utility>
+
+#include "prefab.hpp"
+
+entt::entity Prefab::create(entt::registry& registry, vec2 position) const {
+    entt::entity entity = registry.create();
+    Motion& instance_motion = registry.emplace<Motion>(entity, motion);
+    instance_motion.position = position;
+    for (const Component& component : components)
+        component.insert(registry, &entity, &entity + 1);
+    return entity;
+}
+
+void PrefabBatch::add(const Prefab& prefab, vec2 position) {
+    for (Group& group : groups) {
+        if (group.prefab == &prefab) {
+            group.positions.push_back(position);
+            return;
+        }
+    }
+    groups.push_back({ &prefab, { position } });
+}
+
+void PrefabBatch::create() {
+    // instances per component type, so each pool grows once
+    size_t total = 0;
+    std::vector<std::pair<const Prefab::Component*, size_t>> pool_counts;
+    for (const Group& group : groups) {
+        total += group.positions.size();
+        for (const Prefab::Component& component : group.prefab->components) {
+            auto it = pool_counts.begin();
+            while (it != pool_counts.end() && it->first->type != component.type)
+                ++it;
+            if (it == pool_counts.end())
+                pool_counts.push_back({ &component, group.positions.size() });
+            else
+                it->second += group.positions.size();
+        }
+    }
+    auto& motions = registry.storage<Motion>();
+    motions.reserve(motions.size() + total);
+    for (const auto& [component, count] : pool_counts)
+        component->reserve(registry, count);
+
+    std::vector<entt::entity> entities;
+    std::vector<Motion> instance_motions;
+    for (const Group& group : groups) {
+        size_t count = group.positions.size();
+        entities.resize(count);
+        registry.create(entities.begin(), entities.end());
+
+        instance_motions.assign(count, group.prefab->motion);
+        for (size_t i = 0; i < count; i++)
+            instance_motions[i].position = group.positions[i];
+        registry.insert<Motion>(entities.begin(), entities.end(), instance_motions.begin());
+
+        const entt::entity* first = entities.data();
+        for (const Prefab::Component& component : group.prefab->components)
+            component.insert(registry, first, first + count);
+    }
+    groups.clear();
+}
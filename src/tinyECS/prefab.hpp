@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "registry.hpp"
+
+// A fixed set of components with default values.
+// Every instance gets a copy of each default plus its own Motion: the prefab's motion
+// moved to the instance position. Single instances come from create(); levels collect
+// their instances in a PrefabBatch and create them all at once.
+class Prefab {
+public:
+    explicit Prefab(const Motion& motion) : motion(motion) {}
+
+    template <class T>
+    Prefab& with(const T& value = T()) {
+        components.push_back({
+            entt::type_id<T>().hash(),
+            [](entt::registry& registry, size_t count) {
+                auto& storage = registry.storage<T>();
+                storage.reserve(storage.size() + count);
+            },
+            [value](entt::registry& registry, const entt::entity* first, const entt::entity* last) {
+                registry.insert<T>(first, last, value);
+            }
+        });
+        return *this;
+    }
+
+    entt::entity create(entt::registry& registry, vec2 position) const;
+
+private:
+    friend class PrefabBatch;
+
+    struct Component {
+        entt::id_type type;
+        void (*reserve)(entt::registry& registry, size_t count);
+        std::function<void(entt::registry& registry, const entt::entity* first, const entt::entity* last)> insert;
+    };
+
+    Motion motion;
+    std::vector<Component> components;
+};
+
+// Prefab instances created together.
+// create() reserves every pool once for the whole batch, then per prefab creates its
+// entities with one range create and fills each component with one range insert,
+// instead of a create and a handful of emplaces per entity.
+class PrefabBatch {
+public:
+    explicit PrefabBatch(entt::registry& registry) : registry(registry) {}
+
+    void add(const Prefab& prefab, vec2 position);
+
+    // creates everything added since the last call
+    void create();
+
+private:
+    struct Group {
+        const Prefab* prefab;
+        std::vector<vec2> positions;
+    };
+
+    entt::registry& registry;
+    std::vector<Group> groups;
+};
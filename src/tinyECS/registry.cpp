@@ -1,3 +0,0 @@
-#include "registry.hpp"
-
-entt::registry registry;
\ No newline at end of file
@@ -4,7 +4,6 @@
 
 #include <entt.hpp>
 
-// Declare `registry` (but don't define it here!)
-extern entt::registry registry;
+// there is no global registry; each World owns one (see world.hpp)
 
 #endif // REGISTRY_HPP
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <string>
+
+#include "snapshot.hpp"
+#include "util/logger.hpp"
+
+bool Snapshot::capture(const std::vector<entt::entity>& entities) {
+    clear();
+
+    std::vector<entt::id_type> tracked;
+    for (const auto& pool : pools)
+        tracked.push_back(pool->type());
+    for (auto [id, storage] : registry.storage()) {
+        if (std::find(tracked.begin(), tracked.end(), id) != tracked.end())
+            continue;
+        for (entt::entity entity : entities) {
+            if (storage.contains(entity)) {
+                std::string name(storage.type().name());
+                LOG_WARN("Snapshot skipped: entity %u has untracked component %s",
+                         (unsigned)entt::to_integral(entity), name.c_str());
+                return false;
+            }
+        }
+    }
+
+    for (const auto& pool : pools)
+        pool->capture(registry, entities);
+    entity_count = entities.size();
+    return true;
+}
+
+void Snapshot::restore(std::vector<entt::entity>& entities) const {
+    entities.resize(entity_count);
+    registry.create(entities.begin(), entities.end());
+    for (const auto& pool : pools)
+        pool->restore(registry, entities);
+}
+
+void Snapshot::clear() {
+    for (const auto& pool : pools)
+        pool->clear();
+    entity_count = 0;
+}
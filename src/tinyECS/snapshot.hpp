@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "registry.hpp"
+
+// Copies of the components of a set of entities, kept to recreate those entities later.
+// Only the component types registered with track() are copied. capture() refuses a set
+// in which some entity has any other component, since restoring it would silently drop
+// that component. restore() creates fresh entities and fills each tracked type with one
+// range insert from the stored values, so it costs a few bulk copies per type.
+//
+// Components that hold entity handles would point at the old entities after a restore
+// and must not be tracked.
+class Snapshot {
+public:
+    explicit Snapshot(entt::registry& registry) : registry(registry) {}
+
+    template <class T>
+    Snapshot& track() {
+        pools.push_back(std::make_unique<Pool<T>>());
+        return *this;
+    }
+
+    // false, and the snapshot left empty, if an entity has a component that is not tracked
+    bool capture(const std::vector<entt::entity>& entities);
+
+    // one new entity per captured entity, in capture order
+    void restore(std::vector<entt::entity>& entities) const;
+
+    bool empty() const { return entity_count == 0; }
+    size_t size() const { return entity_count; }
+
+    void clear();
+
+private:
+    struct PoolBase {
+        virtual ~PoolBase() = default;
+        virtual entt::id_type type() const = 0;
+        virtual void capture(entt::registry& registry, const std::vector<entt::entity>& entities) = 0;
+        virtual void restore(entt::registry& registry, const std::vector<entt::entity>& entities) const = 0;
+        virtual void clear() = 0;
+    };
+
+    template <class T>
+    struct Pool : PoolBase {
+        std::vector<uint32_t> indices; // into the captured entity list
+        std::vector<T> values;         // unused for empty (tag) components
+
+        entt::id_type type() const override { return entt::type_id<T>().hash(); }
+
+        void capture(entt::registry& registry, const std::vector<entt::entity>& entities) override {
+            auto& storage = registry.storage<T>();
+            for (uint32_t i = 0; i < (uint32_t)entities.size(); i++) {
+                if (!storage.contains(entities[i]))
+                    continue;
+                indices.push_back(i);
+                if constexpr (!std::is_empty_v<T>)
+                    values.push_back(registry.get<T>(entities[i]));
+            }
+        }
+
+        void restore(entt::registry& registry, const std::vector<entt::entity>& entities) const override {
+            std::vector<entt::entity> targets(indices.size());
+            for (size_t i = 0; i < indices.size(); i++)
+                targets[i] = entities[indices[i]];
+            auto& storage = registry.storage<T>();
+            storage.reserve(storage.size() + targets.size());
+            if constexpr (std::is_empty_v<T>)
+                registry.insert<T>(targets.begin(), targets.end());
+            else
+                registry.insert<T>(targets.begin(), targets.end(), values.begin());
+        }
+
+        void clear() override {
+            indices.clear();
+            values.clear();
+        }
+    };
+
+    entt::registry& registry;
+    std::vector<std::unique_ptr<PoolBase>> pools;
+    size_t entity_count = 0;
+};
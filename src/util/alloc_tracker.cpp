@@ -0,0 +1,199 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "alloc_tracker.hpp"
+#include "logger.hpp"
+#include "perf_counters.hpp"
+#include "profiler.hpp"
+
+#ifdef SQUEAK_TRACK_ALLOCATIONS
+
+namespace {
+    const char* NO_SCOPE = "(no scope)";
+
+    // in front of every tracked block; 16 bytes keeps malloc's alignment
+    struct AllocHeader {
+        uint32_t slot;
+        uint32_t unused;
+        uint64_t size;
+    };
+    static_assert(sizeof(AllocHeader) == 16, "header must preserve 16-byte alignment");
+
+    struct ScopeAllocStats {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> live_count{0};
+        std::atomic<uint64_t> live_bytes{0};
+        std::atomic<uint64_t> frame_allocations{0};
+
+        // main thread only, in endFrame()
+        uint64_t frames = 0;
+        uint64_t max_frame_allocations = 0;
+        uint64_t histogram[AllocTracker::HISTOGRAM_BUCKETS] = {};
+    };
+
+    // plain static storage: usable before any constructor has run
+    ScopeAllocStats scopes[AllocTracker::MAX_SCOPES];
+    std::atomic<uint64_t> total_allocations{0};
+
+    // open addressing on the name pointer; the last slot catches overflow
+    uint32_t slotFor(const char* name) {
+        uint32_t hash = (uint32_t)((uintptr_t)name >> 3) * 2654435761u;
+        for (int probe = 0; probe < AllocTracker::MAX_SCOPES - 1; probe++) {
+            uint32_t slot = (hash + probe) % (AllocTracker::MAX_SCOPES - 1);
+            const char* current = scopes[slot].name.load(std::memory_order_acquire);
+            if (current == name)
+                return slot;
+            if (current == nullptr) {
+                if (scopes[slot].name.compare_exchange_strong(current, name, std::memory_order_acq_rel) || current == name)
+                    return slot;
+            }
+        }
+        return AllocTracker::MAX_SCOPES - 1;
+    }
+
+    void* trackedAllocate(std::size_t size) {
+        void* raw = std::malloc(sizeof(AllocHeader) + size);
+        if (!raw)
+            return nullptr;
+
+        const char* scope = Profiler::currentScope();
+        uint32_t slot = slotFor(scope ? scope : NO_SCOPE);
+        ScopeAllocStats& stats = scopes[slot];
+        stats.allocations.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes.fetch_add(size, std::memory_order_relaxed);
+        stats.live_count.fetch_add(1, std::memory_order_relaxed);
+        stats.live_bytes.fetch_add(size, std::memory_order_relaxed);
+        stats.frame_allocations.fetch_add(1, std::memory_order_relaxed);
+        total_allocations.fetch_add(1, std::memory_order_relaxed);
+
+        AllocHeader* header = static_cast<AllocHeader*>(raw);
+        header->slot = slot;
+        header->size = size;
+        return header + 1;
+    }
+
+    void trackedFree(void* p) {
+        if (!p)
+            return;
+        AllocHeader* header = static_cast<AllocHeader*>(p) - 1;
+        ScopeAllocStats& stats = scopes[header->slot];
+        stats.live_count.fetch_sub(1, std::memory_order_relaxed);
+        stats.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(header);
+    }
+
+    int bucketFor(uint64_t count) {
+        int bucket = 0;
+        while (count > 0 && bucket < AllocTracker::HISTOGRAM_BUCKETS - 1) {
+            count >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = trackedAllocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = trackedAllocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+
+bool AllocTracker::enabled() {
+    return true;
+}
+
+void AllocTracker::endFrame() {
+    uint64_t frame_total = 0;
+    for (ScopeAllocStats& stats : scopes) {
+        if (stats.name.load(std::memory_order_acquire) == nullptr)
+            continue;
+        uint64_t count = stats.frame_allocations.exchange(0, std::memory_order_relaxed);
+        stats.frames++;
+        stats.histogram[bucketFor(count)]++;
+        if (count > stats.max_frame_allocations)
+            stats.max_frame_allocations = count;
+        frame_total += count;
+    }
+    PerfCounters::add(PerfCounter::HEAP_ALLOCATIONS, frame_total);
+}
+
+uint64_t AllocTracker::totalAllocations() {
+    return total_allocations.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::report() {
+    LOG_INFO("allocations by profiler scope (histogram: frames with 0, 1, 2-3, 4-7, ... allocations)");
+    for (ScopeAllocStats& stats : scopes) {
+        const char* name = stats.name.load(std::memory_order_acquire);
+        if (name == nullptr)
+            continue;
+
+        char histogram[160];
+        int length = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS && length < (int)sizeof(histogram); i++)
+            length += snprintf(histogram + length, sizeof(histogram) - length, "%s%llu", i ? " " : "", (unsigned long long)stats.histogram[i]);
+
+        uint64_t allocations = stats.allocations.load(std::memory_order_relaxed);
+        LOG_INFO("  %-20s %10llu allocs %12llu bytes  %8.1f/frame  max %llu  [%s]",
+            name,
+            (unsigned long long)allocations,
+            (unsigned long long)stats.bytes.load(std::memory_order_relaxed),
+            stats.frames ? (double)allocations / stats.frames : 0.0,
+            (unsigned long long)stats.max_frame_allocations,
+            histogram);
+    }
+
+    LOG_INFO("still allocated at exit, by allocating scope");
+    for (ScopeAllocStats& stats : scopes) {
+        const char* name = stats.name.load(std::memory_order_acquire);
+        uint64_t live = stats.live_count.load(std::memory_order_relaxed);
+        if (name == nullptr || live == 0)
+            continue;
+        LOG_WARN("  %-20s %10llu blocks %12llu bytes", name,
+            (unsigned long long)live, (unsigned long long)stats.live_bytes.load(std::memory_order_relaxed));
+    }
+}
+
+#else
+
+bool AllocTracker::enabled() {
+    return false;
+}
+
+void AllocTracker::endFrame() {
+}
+
+uint64_t AllocTracker::totalAllocations() {
+    return 0;
+}
+
+void AllocTracker::report() {
+}
+
+#endif
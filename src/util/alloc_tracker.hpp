@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocation tracking, compiled in with SQUEAK_TRACK_ALLOCATIONS
+// (cmake -DSQUEAK_TRACK_ALLOCATIONS=ON).
+// The global operator new/delete are replaced to charge every allocation, its bytes and
+// its matching delete to the innermost Profiler scope open on the calling thread (or to
+// "(no scope)"). endFrame() folds the frame's counts into a per-scope histogram of
+// allocations per frame; report() prints those and what each scope still holds, as a
+// leak report at exit. Aligned new is not tracked. Without the define every call is a no-op.
+class AllocTracker {
+public:
+    AllocTracker() = delete;
+
+    static const int MAX_SCOPES = 256;
+    static const int HISTOGRAM_BUCKETS = 12;
+
+    static bool enabled();
+
+    static void endFrame();
+
+    static uint64_t totalAllocations();
+
+    static void report();
+};
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "frame_arena.hpp"
+
+namespace {
+    char* allocateBlock(size_t size) {
+        char* data = static_cast<char*>(std::malloc(size));
+        if (!data)
+            throw std::bad_alloc();
+        return data;
+    }
+}
+
+FrameArena::FrameArena(size_t initial_bytes) {
+    blocks.push_back({ allocateBlock(initial_bytes), initial_bytes });
+}
+
+FrameArena::~FrameArena() {
+    for (Block& block : blocks)
+        std::free(block.data);
+}
+
+FrameArena& FrameArena::frame() {
+    thread_local FrameArena arena(FRAME_ARENA_INITIAL_BYTES);
+    return arena;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    for (;;) {
+        Block& block = blocks[block_index];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+        size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + bytes <= block.size) {
+            offset = aligned + bytes;
+            used_bytes += bytes;
+            frame_high_water = std::max(frame_high_water, used_bytes);
+            return block.data + aligned;
+        }
+
+        // continue in the next block, growing the chain if this is the last one
+        block_index++;
+        offset = 0;
+        if (block_index == blocks.size()) {
+            size_t size = std::max(blocks.back().size * 2, bytes + alignment);
+            blocks.push_back({ allocateBlock(size), size });
+        }
+    }
+}
+
+void FrameArena::reset() {
+    last_frame_bytes = frame_high_water;
+    peak_bytes = std::max(peak_bytes, frame_high_water);
+
+    if (blocks.size() > 1) {
+        // one block that holds the whole chain, so the next frame like this one fits
+        size_t total = capacity();
+        for (Block& block : blocks)
+            std::free(block.data);
+        blocks.clear();
+        blocks.push_back({ allocateBlock(total), total });
+    }
+    block_index = 0;
+    offset = 0;
+    used_bytes = 0;
+    frame_high_water = 0;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks)
+        total += block.size;
+    return total;
+}
+
+void FrameArena::rewind(const Marker& marker) {
+    assert(marker.block <= block_index);
+    block_index = marker.block;
+    offset = marker.offset;
+    used_bytes = marker.used_bytes;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives at most one frame.
+// allocate() bumps an offset; nothing is freed individually. The main loop calls reset()
+// at the top of every frame. If a frame outgrows the current block a new one is chained
+// on, and the next reset() replaces the chain with a single block big enough for it, so
+// a steady frame stops calling malloc after the first few frames.
+// Not thread-safe. frame() is per thread: the main loop resets the main thread's arena,
+// job system workers only use theirs inside a FrameArenaScope.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initial_bytes);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    static const size_t FRAME_ARENA_INITIAL_BYTES = 1 << 20;
+
+    // the calling thread's arena
+    static FrameArena& frame();
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    // uninitialized storage for count trivially destructible values
+    template <class T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    // bytes handed out since the last reset, and the most in any frame so far
+    size_t usedBytes() const { return used_bytes; }
+    size_t lastFrameBytes() const { return last_frame_bytes; }
+    size_t peakBytes() const { return peak_bytes; }
+    size_t capacity() const;
+
+    struct Marker {
+        size_t block = 0;
+        size_t offset = 0;
+        size_t used_bytes = 0;
+    };
+
+    // release everything allocated after the marker was taken
+    Marker mark() const { return { block_index, offset, used_bytes }; }
+    void rewind(const Marker& marker);
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block_index = 0;
+    size_t offset = 0;
+    size_t used_bytes = 0;
+    size_t frame_high_water = 0;
+    size_t last_frame_bytes = 0;
+    size_t peak_bytes = 0;
+};
+
+// Frees the arena allocations of a scope (e.g. one narrowphase test) when it ends.
+class FrameArenaScope {
+public:
+    explicit FrameArenaScope(FrameArena& arena = FrameArena::frame())
+        : arena(arena), marker(arena.mark()) {}
+    ~FrameArenaScope() { arena.rewind(marker); }
+
+    FrameArenaScope(const FrameArenaScope&) = delete;
+    FrameArenaScope& operator=(const FrameArenaScope&) = delete;
+
+private:
+    FrameArena& arena;
+    FrameArena::Marker marker;
+};
+
+// STL allocator over a FrameArena; deallocate is a no-op. Containers using it must not
+// outlive the frame (or the enclosing FrameArenaScope).
+template <class T>
+class FrameAllocator {
+public:
+    using value_type = T;
+
+    FrameAllocator() noexcept : arena(&FrameArena::frame()) {}
+    explicit FrameAllocator(FrameArena& arena) noexcept : arena(&arena) {}
+    template <class U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    template <class U>
+    bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+
+    FrameArena* arena;
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
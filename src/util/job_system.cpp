@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "job_system.hpp"
+
+namespace {
+    // queue index of the calling thread; -1 outside the pool (uses the shared queue)
+    thread_local int worker_index = -1;
+    thread_local const void* worker_owner = nullptr;
+
+    // empty polls before a worker goes to sleep
+    const int IDLE_SPINS = 64;
+
+    struct ParallelForState {
+        const std::function<void(int, int)>* fn;
+        std::atomic<int> next_chunk{0};
+        int count;
+        int chunk_size;
+        int chunk_count;
+
+        void runChunks() {
+            for (int chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) {
+                int begin = chunk * chunk_size;
+                (*fn)(begin, std::min(begin + chunk_size, count));
+            }
+        }
+    };
+}
+
+JobSystem::JobSystem(unsigned int worker_count) {
+    for (unsigned int i = 0; i <= worker_count; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+    for (unsigned int i = 0; i < worker_count; i++)
+        threads.emplace_back(&JobSystem::workerLoop, this, (int)i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+JobSystem& JobSystem::shared() {
+    static JobSystem jobs;
+    return jobs;
+}
+
+unsigned int JobSystem::defaultWorkerCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void JobSystem::push(Job job) {
+    int index = worker_owner == this ? worker_index : (int)threads.size();
+    {
+        WorkQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // taking the lock orders this with a worker that is about to sleep
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    wake.notify_one();
+}
+
+bool JobSystem::pop(Job& out_job) {
+    if (queued.load(std::memory_order_acquire) == 0)
+        return false;
+
+    int own = worker_owner == this ? worker_index : (int)threads.size();
+    {
+        // newest first from our own queue, while it is still warm in cache
+        WorkQueue& queue = *queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            out_job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // steal the oldest job of someone else
+    int queue_count = (int)queues.size();
+    for (int offset = 1; offset < queue_count; offset++) {
+        WorkQueue& queue = *queues[(own + offset) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            out_job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job) {
+    job.fn();
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    if (counter == nullptr)
+        return;
+
+    // decremented under the lock: wait() takes it once before returning, so the counter is
+    // not destroyed while this is still using it
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ready.swap(counter->continuations);
+    }
+    for (Job& job : ready)
+        push(std::move(job));
+}
+
+void JobSystem::run(std::function<void()> fn, JobCounter* counter) {
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    // without workers, run inline
+    if (threads.empty()) {
+        Job job{ std::move(fn), counter };
+        execute(job);
+        return;
+    }
+    push(Job{ std::move(fn), counter });
+}
+
+void JobSystem::runAfter(JobCounter& after, std::function<void()> fn, JobCounter* counter) {
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(after.mutex);
+        if (!after.done()) {
+            after.continuations.push_back(Job{ std::move(fn), counter });
+            return;
+        }
+    }
+
+    // already finished; the counter was incremented above, so hand it over as is
+    if (threads.empty()) {
+        Job job{ std::move(fn), counter };
+        execute(job);
+    } else {
+        push(Job{ std::move(fn), counter });
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    Job job;
+    while (!counter.done()) {
+        if (pop(job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(int count, int chunk_size, const std::function<void(int, int)>& fn) {
+    if (count <= 0)
+        return;
+    chunk_size = std::max(chunk_size, 1);
+
+    // not worth waking anyone up
+    if (threads.empty() || count <= chunk_size) {
+        fn(0, count);
+        return;
+    }
+
+    // a few claimers pull chunks from a shared index; the caller is one of them
+    ParallelForState state;
+    state.fn = &fn;
+    state.count = count;
+    state.chunk_size = chunk_size;
+    state.chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    JobCounter counter;
+    int helpers = std::min(state.chunk_count - 1, (int)threads.size());
+    ParallelForState* shared_state = &state;
+    for (int i = 0; i < helpers; i++)
+        run([shared_state] { shared_state->runChunks(); }, &counter);
+
+    state.runChunks();
+    wait(counter);
+}
+
+void JobSystem::workerLoop(int index) {
+    worker_index = index;
+    worker_owner = this;
+
+    Job job;
+    int idle = 0;
+    while (true) {
+        if (pop(job)) {
+            execute(job);
+            job = Job();
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping)
+            return;
+        idle = 0;
+    }
+}
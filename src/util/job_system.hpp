@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job {
+    std::function<void()> fn;
+    JobCounter* counter = nullptr;
+};
+
+// Completion count for a group of jobs. Jobs are added with JobSystem::run / runAfter and
+// the counter is done once all of them have finished. Continuations registered with
+// runAfter are scheduled when it reaches zero. Must be waited on before it is destroyed.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> pending{0};
+    std::mutex mutex;
+    std::vector<Job> continuations;
+};
+
+// Work-stealing job system.
+// Every worker owns a deque: it pushes and pops its own jobs at the back and, when empty,
+// steals from the front of the others. Threads outside the pool (the main thread) share
+// one more deque. wait() and parallelFor() never just block: the waiting thread runs
+// queued jobs until its counter is done, so nested fork-join cannot deadlock.
+// Jobs must not touch state another job writes; registry structure (create, destroy,
+// emplace, remove) stays on the main thread.
+class JobSystem {
+public:
+    explicit JobSystem(unsigned int worker_count = defaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // job system shared by the game systems, started on first use
+    static JobSystem& shared();
+
+    // one thread per core, minus the main thread
+    static unsigned int defaultWorkerCount();
+
+    unsigned int workerCount() const { return (unsigned int)threads.size(); }
+
+    // fork: schedule fn, counted on counter if given
+    void run(std::function<void()> fn, JobCounter* counter = nullptr);
+
+    // dependency: schedule fn once `after` is done
+    void runAfter(JobCounter& after, std::function<void()> fn, JobCounter* counter = nullptr);
+
+    // join: run other jobs until counter is done
+    void wait(JobCounter& counter);
+
+    // fn(begin, end) for consecutive ranges of at most chunk_size items, returns when all are done
+    void parallelFor(int count, int chunk_size, const std::function<void(int, int)>& fn);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void push(Job job);
+    bool pop(Job& out_job);
+    void execute(Job& job);
+    void finish(JobCounter* counter);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; // one per worker, then the shared one
+    std::vector<std::thread> threads;
+
+    std::atomic<int> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "logger.hpp"
+
+namespace {
+    // how long the printer sleeps when the ring is empty
+    const auto IDLE_SLEEP = std::chrono::milliseconds(2);
+
+    const char* LEVEL_NAMES[] = { "trace", "debug", "info", "warn", "error" };
+
+    struct LogSlot {
+        // == index: free for the producer claiming index
+        // == index + 1: message published for the printer
+        std::atomic<uint64_t> sequence{0};
+        LogLevel level = LogLevel::INFO;
+        char text[Logger::MESSAGE_CAPACITY];
+    };
+
+    LogLevel levelFromEnvironment() {
+        if (const char* env = std::getenv("SQUEAK_LOG_LEVEL")) {
+            for (int i = 0; i <= (int)LogLevel::ERR; i++) {
+                if (std::strcmp(env, LEVEL_NAMES[i]) == 0)
+                    return (LogLevel)i;
+            }
+        }
+        return LogLevel::INFO;
+    }
+
+    // bounded multi-producer queue (one sequence number per slot) with a single printer thread
+    class LogState {
+    public:
+        LogSlot slots[Logger::RING_CAPACITY];
+        std::atomic<uint64_t> enqueue_index{0};
+        std::atomic<uint64_t> dequeue_index{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<int> min_level;
+        std::atomic<bool> running{true};
+        std::thread printer;
+
+        LogState() : min_level((int)levelFromEnvironment()) {
+            for (uint64_t i = 0; i < Logger::RING_CAPACITY; i++)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            printer = std::thread([this] { run(); });
+        }
+
+        ~LogState() {
+            running.store(false);
+            if (printer.joinable())
+                printer.join();
+        }
+
+        LogSlot* claim() {
+            uint64_t index = enqueue_index.load(std::memory_order_relaxed);
+            for (;;) {
+                LogSlot& slot = slots[index % Logger::RING_CAPACITY];
+                int64_t diff = (int64_t)slot.sequence.load(std::memory_order_acquire) - (int64_t)index;
+                if (diff == 0) {
+                    if (enqueue_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+                        return &slot;
+                } else if (diff < 0) {
+                    // the printer has not freed this slot yet: full
+                    return nullptr;
+                } else {
+                    index = enqueue_index.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // prints every published message; returns false if there was nothing to print
+        bool drain() {
+            bool printed = false;
+            for (;;) {
+                uint64_t index = dequeue_index.load(std::memory_order_relaxed);
+                LogSlot& slot = slots[index % Logger::RING_CAPACITY];
+                if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+                    break;
+
+                FILE* out = slot.level >= LogLevel::WARN ? stderr : stdout;
+                fprintf(out, "[%s] %s\n", LEVEL_NAMES[(int)slot.level], slot.text);
+                printed = true;
+
+                slot.sequence.store(index + Logger::RING_CAPACITY, std::memory_order_release);
+                dequeue_index.store(index + 1, std::memory_order_release);
+            }
+
+            uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                fprintf(stderr, "[warn] log ring full, dropped %llu messages\n", (unsigned long long)lost);
+                printed = true;
+            }
+            if (printed) {
+                fflush(stdout);
+                fflush(stderr);
+            }
+            return printed;
+        }
+
+        void run() {
+            while (running.load(std::memory_order_relaxed)) {
+                if (!drain())
+                    std::this_thread::sleep_for(IDLE_SLEEP);
+            }
+            drain();
+        }
+    };
+
+    LogState& logState() {
+        static LogState state;
+        return state;
+    }
+}
+
+void Logger::setLevel(LogLevel level) {
+    logState().min_level.store((int)level, std::memory_order_relaxed);
+}
+
+bool Logger::enabled(LogLevel level) {
+    return (int)level >= logState().min_level.load(std::memory_order_relaxed);
+}
+
+void Logger::write(LogLevel level, const char* format, ...) {
+    LogState& state = logState();
+    if ((int)level < state.min_level.load(std::memory_order_relaxed))
+        return;
+
+    LogSlot* slot = state.claim();
+    if (!slot) {
+        state.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // the index this slot was claimed for is the sequence it was free at
+    uint64_t index = slot->sequence.load(std::memory_order_relaxed);
+    slot->level = level;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    va_end(args);
+    slot->sequence.store(index + 1, std::memory_order_release);
+}
+
+void Logger::flush() {
+    LogState& state = logState();
+    uint64_t target = state.enqueue_index.load(std::memory_order_acquire);
+    while (state.dequeue_index.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+}
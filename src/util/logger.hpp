@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+enum class LogLevel : uint8_t {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERR = 4
+};
+
+// Levels below SQUEAK_LOG_MIN_LEVEL are compiled out, arguments and all.
+#ifndef SQUEAK_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define SQUEAK_LOG_MIN_LEVEL 1
+#else
+#define SQUEAK_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Asynchronous logger.
+// write() formats into a slot of a fixed ring and returns; a background thread prints
+// the slots in order (WARN and ERR to stderr). Claiming a slot is a compare-and-swap, so
+// callers never wait on the terminal or on each other. When the ring is full the message
+// is dropped and counted rather than blocking. The runtime level starts at INFO, or at
+// SQUEAK_LOG_LEVEL (trace, debug, info, warn, error) when set.
+class Logger {
+public:
+    Logger() = delete;
+
+    static const int RING_CAPACITY = 1024;
+    static const int MESSAGE_CAPACITY = 496;
+
+    static void setLevel(LogLevel level);
+    static bool enabled(LogLevel level);
+
+    // printf-style; longer messages are truncated to MESSAGE_CAPACITY
+    static void write(LogLevel level, const char* format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+    // block until everything written so far has been printed
+    static void flush();
+};
+
+#if SQUEAK_LOG_MIN_LEVEL <= 0
+#define LOG_TRACE(...) Logger::write(LogLevel::TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if SQUEAK_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG(...) Logger::write(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if SQUEAK_LOG_MIN_LEVEL <= 2
+#define LOG_INFO(...) Logger::write(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if SQUEAK_LOG_MIN_LEVEL <= 3
+#define LOG_WARN(...) Logger::write(LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) Logger::write(LogLevel::ERR, __VA_ARGS__)
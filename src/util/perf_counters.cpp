@@ -0,0 +1,87 @@
+#include <fstream>
+
+#include "logger.hpp"
+#include "perf_counters.hpp"
+
+namespace {
+    const char* COUNTER_NAMES[(int)PerfCounter::COUNT] = {
+        "physics_pairs_tested",
+        "physics_narrowphase",
+        "astar_nodes_expanded",
+        "boid_neighbor_checks",
+        "entities_created",
+        "entities_destroyed",
+        "gl_draw_calls",
+        "gl_state_changes",
+        "gl_uniform_uploads",
+        "sounds_played",
+        "frame_arena_bytes",
+        "heap_allocations"
+    };
+
+    struct FrameSnapshot {
+        uint64_t frame = 0;
+        uint64_t values[(int)PerfCounter::COUNT] = {};
+    };
+
+    FrameSnapshot history[PerfCounters::PERF_HISTORY_FRAMES];
+    uint64_t frames_recorded = 0;
+
+    void onEntityCreated(entt::registry&, entt::entity) {
+        PerfCounters::add(PerfCounter::ENTITIES_CREATED);
+    }
+
+    void onEntityDestroyed(entt::registry&, entt::entity) {
+        PerfCounters::add(PerfCounter::ENTITIES_DESTROYED);
+    }
+}
+
+std::atomic<uint64_t> PerfCounters::values[(int)PerfCounter::COUNT];
+
+const char* PerfCounters::name(PerfCounter counter) {
+    return COUNTER_NAMES[(int)counter];
+}
+
+void PerfCounters::watchRegistry(entt::registry& registry) {
+    registry.on_construct<entt::entity>().connect<&onEntityCreated>();
+    registry.on_destroy<entt::entity>().connect<&onEntityDestroyed>();
+}
+
+void PerfCounters::endFrame() {
+    FrameSnapshot& snapshot = history[frames_recorded % PERF_HISTORY_FRAMES];
+    snapshot.frame = frames_recorded;
+    for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+        snapshot.values[i] = values[i].exchange(0, std::memory_order_relaxed);
+    frames_recorded++;
+}
+
+uint64_t PerfCounters::lastFrame(PerfCounter counter) {
+    if (frames_recorded == 0)
+        return 0;
+    return history[(frames_recorded - 1) % PERF_HISTORY_FRAMES].values[(int)counter];
+}
+
+bool PerfCounters::dumpCsv(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        LOG_ERROR("Could not write counters: %s", path.c_str());
+        return false;
+    }
+
+    out << "frame";
+    for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+        out << "," << COUNTER_NAMES[i];
+    out << "\n";
+
+    uint64_t first = frames_recorded > PERF_HISTORY_FRAMES ? frames_recorded - PERF_HISTORY_FRAMES : 0;
+    for (uint64_t frame = first; frame < frames_recorded; frame++) {
+        const FrameSnapshot& snapshot = history[frame % PERF_HISTORY_FRAMES];
+        out << snapshot.frame;
+        for (int i = 0; i < (int)PerfCounter::COUNT; i++)
+            out << "," << snapshot.values[i];
+        out << "\n";
+    }
+
+    LOG_INFO("Wrote %llu frames of counters to %s", (unsigned long long)(frames_recorded - first), path.c_str());
+    return true;
+}
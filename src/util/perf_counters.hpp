@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <entt.hpp>
+
+// Work done by the hot paths, counted per frame.
+enum class PerfCounter {
+    PHYSICS_PAIRS_TESTED = 0,   // pairs that reached the bounding box test
+    PHYSICS_NARROWPHASE,        // mesh collision tests
+    ASTAR_NODES_EXPANDED,
+    BOID_NEIGHBOR_CHECKS,
+    ENTITIES_CREATED,
+    ENTITIES_DESTROYED,
+    GL_DRAW_CALLS,
+    GL_STATE_CHANGES,           // program, buffer, texture and framebuffer binds
+    GL_UNIFORM_UPLOADS,
+    SOUNDS_PLAYED,
+    FRAME_ARENA_BYTES,          // high-water mark of the frame arena
+    HEAP_ALLOCATIONS,           // only with SQUEAK_TRACK_ALLOCATIONS
+    COUNT
+};
+
+// Named counters that any thread may bump with a relaxed atomic add.
+// endFrame() moves the running values into a history of the last PERF_HISTORY_FRAMES
+// frames (main thread only); dumpCsv() writes that history, one row per frame.
+class PerfCounters {
+public:
+    PerfCounters() = delete;
+
+    static const int PERF_HISTORY_FRAMES = 600;
+
+    static void add(PerfCounter counter, uint64_t amount = 1) {
+        values[(int)counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    static const char* name(PerfCounter counter);
+
+    // count entity creation and destruction through the registry's signals
+    static void watchRegistry(entt::registry& registry);
+
+    static void endFrame();
+
+    // value of the counter over the last completed frame
+    static uint64_t lastFrame(PerfCounter counter);
+
+    static bool dumpCsv(const std::string& path);
+
+private:
+    static std::atomic<uint64_t> values[(int)PerfCounter::COUNT];
+};
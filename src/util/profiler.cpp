@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "logger.hpp"
+#include "profiler.hpp"
+
+namespace {
+    // weight of the newest frame in the rolling averages (~1/20 s at 60 fps)
+    const float AVERAGE_ALPHA = 0.05f;
+
+    struct ScopeStats {
+        const char* name;
+        int depth;          // shallowest depth the scope was seen at
+        float frame_ms;     // accumulated during the current endFrame()
+        float average_ms;
+    };
+
+    ProfileEvent ring[Profiler::CAPACITY];
+    std::atomic<uint64_t> write_index{0};
+
+    // main-thread state, touched only by endFrame() and the readers
+    uint64_t frame_start_index = 0;
+    std::vector<ScopeStats> stats;
+
+    std::atomic<uint16_t> next_thread_id{0};
+    thread_local uint16_t thread_id = next_thread_id.fetch_add(1);
+    thread_local int thread_depth = 0;
+    thread_local const char* thread_scope = nullptr;
+
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    bool sameName(const char* a, const char* b) {
+        return a == b || std::strcmp(a, b) == 0;
+    }
+
+    ScopeStats& statsFor(const char* name, int depth) {
+        for (ScopeStats& s : stats) {
+            if (sameName(s.name, name)) {
+                if (depth < s.depth)
+                    s.depth = depth;
+                return s;
+            }
+        }
+        stats.push_back({ name, depth, 0.f, 0.f });
+        return stats.back();
+    }
+
+    // copy a slot out, or return false if it was overwritten or is still being written
+    bool readEvent(uint64_t index, ProfileEvent& out) {
+        const ProfileEvent& slot = ring[index % Profiler::CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+            return false;
+        out.name = slot.name;
+        out.start_ns = slot.start_ns;
+        out.duration_ns = slot.duration_ns;
+        out.thread = slot.thread;
+        out.depth = slot.depth;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+    }
+
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+        out << '"';
+    }
+}
+
+int64_t Profiler::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, int64_t start_ns, int64_t end_ns, int depth) {
+    uint64_t index = write_index.fetch_add(1, std::memory_order_relaxed);
+    ProfileEvent& slot = ring[index % CAPACITY];
+    // invalidate first so a reader never pairs the old sequence with new fields
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name = name;
+    slot.start_ns = start_ns;
+    slot.duration_ns = end_ns - start_ns;
+    slot.thread = thread_id;
+    slot.depth = (uint16_t)depth;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::endFrame() {
+    uint64_t end_index = write_index.load(std::memory_order_acquire);
+    uint64_t begin_index = frame_start_index;
+    if (end_index - begin_index > CAPACITY)
+        begin_index = end_index - CAPACITY;
+    frame_start_index = end_index;
+
+    for (ScopeStats& s : stats)
+        s.frame_ms = 0.f;
+
+    ProfileEvent event;
+    for (uint64_t i = begin_index; i < end_index; i++) {
+        if (readEvent(i, event))
+            statsFor(event.name, event.depth).frame_ms += event.duration_ns / 1e6f;
+    }
+
+    // scopes that did not run this frame decay towards zero
+    for (ScopeStats& s : stats)
+        s.average_ms += (s.frame_ms - s.average_ms) * AVERAGE_ALPHA;
+}
+
+float Profiler::averageMs(const char* name) {
+    for (const ScopeStats& s : stats) {
+        if (sameName(s.name, name))
+            return s.average_ms;
+    }
+    return 0.f;
+}
+
+std::string Profiler::summary() {
+    std::string text;
+    char buffer[64];
+    for (const ScopeStats& s : stats) {
+        if (s.depth != 1)
+            continue;
+        snprintf(buffer, sizeof(buffer), "%s%s %.2f", text.empty() ? "" : "  ", s.name, s.average_ms);
+        text += buffer;
+    }
+    return text;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        LOG_ERROR("Could not write trace: %s", path.c_str());
+        return false;
+    }
+
+    uint64_t end_index = write_index.load(std::memory_order_acquire);
+    uint64_t begin_index = end_index > CAPACITY ? end_index - CAPACITY : 0;
+
+    // complete ("X") events with microsecond timestamps
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    int count = 0;
+    ProfileEvent event;
+    for (uint64_t i = begin_index; i < end_index; i++) {
+        if (!readEvent(i, event))
+            continue;
+        out << (first ? "" : ",\n") << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"squeak\",\"ph\":\"X\",\"ts\":" << event.start_ns / 1000.0
+            << ",\"dur\":" << event.duration_ns / 1000.0
+            << ",\"pid\":1,\"tid\":" << event.thread << "}";
+        first = false;
+        count++;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    LOG_INFO("Wrote %d profile events to %s", count, path.c_str());
+    return true;
+}
+
+const char* Profiler::currentScope() {
+    return thread_scope;
+}
+
+int Profiler::currentDepth() {
+    return thread_depth;
+}
+
+ProfileScope::ProfileScope(const char* name)
+    : name(name), parent(thread_scope), start_ns(Profiler::nowNs()), depth(thread_depth), outer_depth(thread_depth) {
+    thread_scope = name;
+    thread_depth = depth + 1;
+}
+
+ProfileScope::ProfileScope(const char* name, int depth)
+    : name(name), parent(thread_scope), start_ns(Profiler::nowNs()), depth(depth), outer_depth(thread_depth) {
+    thread_scope = name;
+    thread_depth = depth + 1;
+}
+
+ProfileScope::~ProfileScope() {
+    thread_scope = parent;
+    thread_depth = outer_depth;
+    Profiler::record(name, start_ns, Profiler::nowNs(), depth);
+}
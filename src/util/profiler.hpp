@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// One closed scope. name must be a string literal (only the pointer is stored).
+struct ProfileEvent {
+    const char* name = nullptr;
+    int64_t start_ns = 0;
+    int64_t duration_ns = 0;
+    uint16_t thread = 0;
+    uint16_t depth = 0;
+    std::atomic<uint64_t> sequence{0}; // index + 1 once the slot is complete
+};
+
+// Scoped CPU timers collected into a fixed ring buffer.
+// Any thread may record; a slot is claimed with one atomic increment, so recording never
+// locks. Older events are overwritten once the ring wraps. endFrame() and the exports read
+// from the main thread between frames; slots still being written are skipped.
+class Profiler {
+public:
+    Profiler() = delete;
+
+    static const uint32_t CAPACITY = 1 << 16;
+
+    static int64_t nowNs();
+
+    static void record(const char* name, int64_t start_ns, int64_t end_ns, int depth);
+
+    // fold the events since the last call into the rolling per-scope averages
+    static void endFrame();
+
+    // rolling average time per frame spent in the named scope, in ms
+    static float averageMs(const char* name);
+
+    // "name ms" pairs for the scopes directly inside the frame scope, for the HUD
+    static std::string summary();
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto) of the events still in the ring
+    static bool exportChromeTrace(const std::string& path);
+
+    // innermost open scope on the calling thread, nullptr outside any scope
+    static const char* currentScope();
+
+    // nesting depth of the next scope opened on the calling thread
+    static int currentDepth();
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name);
+    // for work handed to another thread: nests at depth there (see Profiler::currentDepth)
+    ProfileScope(const char* name, int depth);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    const char* parent;
+    int64_t start_ns;
+    int depth;
+    int outer_depth;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// times the rest of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
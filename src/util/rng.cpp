@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <random>
+
+#include "rng.hpp"
+
+namespace {
+    uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+}
+
+void Rng::reseed(uint64_t seed) {
+    uint64_t x = seed;
+    uint64_t a = splitmix64(x);
+    uint64_t b = splitmix64(x);
+    state[0] = (uint32_t)a;
+    state[1] = (uint32_t)(a >> 32);
+    state[2] = (uint32_t)b;
+    state[3] = (uint32_t)(b >> 32);
+}
+
+void RandomStreams::reseed(uint64_t seed) {
+    base_seed = seed;
+    for (int i = 0; i < (int)RngStream::COUNT; i++) {
+        // decorrelate the streams by mixing the stream index into the seed
+        uint64_t mix = seed ^ (0xd1b54a32d192ed03ull * (uint64_t)(i + 1));
+        streams[i].reseed(splitmix64(mix));
+    }
+}
+
+uint64_t Random::seedFromEnvironment() {
+    if (const char* env = std::getenv("SQUEAK_SEED")) {
+        return std::strtoull(env, nullptr, 10);
+    }
+    std::random_device rd;
+    return ((uint64_t)rd() << 32) | rd();
+}
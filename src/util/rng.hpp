@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+// xoshiro128** generator: 16 bytes of state, a handful of instructions per number.
+// Satisfies UniformRandomBitGenerator, so it also works with the <random> distributions.
+class Rng {
+public:
+    using result_type = uint32_t;
+
+    explicit Rng(uint64_t seed = 0) { reseed(seed); }
+
+    // state is expanded from the seed with splitmix64
+    void reseed(uint64_t seed);
+
+    uint32_t operator()() {
+        const uint32_t result = rotl(state[1] * 5, 7) * 9;
+        const uint32_t t = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 11);
+        return result;
+    }
+
+    // uniform float in [0, 1)
+    float uniform() { return ((*this)() >> 8) * (1.0f / 16777216.0f); }
+
+    // uniform float in [lo, hi)
+    float uniform(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+
+    static constexpr uint32_t min() { return 0; }
+    static constexpr uint32_t max() { return UINT32_MAX; }
+
+private:
+    static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+    uint32_t state[4];
+};
+
+// one independent stream per system, so adding draws in one system does not shift another
+enum class RngStream {
+    WORLD = 0,
+    BOIDS_SPAWN = 1,
+    BOIDS_WANDER = 2,
+    COUNT = 3
+};
+
+// The random streams of one simulation (see World), all derived from a single seed.
+// Running twice with the same seed gives the same sequence in every stream.
+class RandomStreams {
+public:
+    explicit RandomStreams(uint64_t seed = 0) { reseed(seed); }
+
+    // reseed every stream from this seed
+    void reseed(uint64_t seed);
+    uint64_t seed() const { return base_seed; }
+
+    Rng& stream(RngStream which) { return streams[(int)which]; }
+
+private:
+    uint64_t base_seed = 0;
+    Rng streams[(int)RngStream::COUNT];
+};
+
+class Random {
+public:
+    Random() = delete;
+
+    // SQUEAK_SEED if set, otherwise a fresh random seed from std::random_device
+    static uint64_t seedFromEnvironment();
+};
@@ -4,73 +4,80 @@ class WorldGrid {
 public:
     WorldGrid() = delete;
 
-    static entt::entity createPlayerAtGridPos(RenderSystem *renderer, vec2 grid_pos) {
+    // centre of a grid cell in world coordinates
+    static vec2 gridToWorld(vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createPlayer(renderer, vec2(x_pos, y_pos));
+        return vec2(x_pos, y_pos);
     }
 
-    static entt::entity createSniperAtGridPos(RenderSystem *renderer, vec2 grid_pos, Direction direction) {
+    static entt::entity createPlayerAtGridPos(World& world, RenderSystem *renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createSniperEnemy(renderer, vec2(x_pos, y_pos), direction);
+        return createPlayer(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createNWEWallAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createSniperAtGridPos(World& world, RenderSystem *renderer, vec2 grid_pos, Direction direction) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createNWEWall(renderer, vec2(x_pos, y_pos));
+        return createSniperEnemy(world, renderer, vec2(x_pos, y_pos), direction);
     }
 
-    static entt::entity createSouthWallAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createNWEWallAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createSouthWall(renderer, vec2(x_pos, y_pos));
+        return createNWEWall(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createFloorAtGridPos(vec2 grid_pos) {
+    static entt::entity createSouthWallAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createFloorTile(vec2(x_pos, y_pos));
+        return createSouthWall(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createFloorIceAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createFloorAtGridPos(World& world, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createFloorIce(renderer, vec2(x_pos, y_pos));
+        return createFloorTile(world, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createBlankAtGridPos(vec2 grid_pos) {
+    static entt::entity createFloorIceAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createBlankTile(vec2(x_pos, y_pos));
+        return createFloorIce(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createDoorAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createBlankAtGridPos(World& world, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createDoor(renderer, vec2(x_pos, y_pos));
+        return createBlankTile(world, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createExitAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createDoorAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createExit(renderer, vec2(x_pos, y_pos));
+        return createDoor(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createKeyAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createExitAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createKey(renderer, vec2(x_pos, y_pos));
+        return createExit(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createCheeseAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createKeyAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createCheese(renderer, vec2(x_pos, y_pos));
+        return createKey(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createPatrolEnemyAtGridPos(RenderSystem* renderer, std::vector<vec2> positions) {
+    static entt::entity createCheeseAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
+        int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
+        int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
+        return createCheese(world, renderer, vec2(x_pos, y_pos));
+    }
+
+    static entt::entity createPatrolEnemyAtGridPos(World& world, RenderSystem* renderer, std::vector<vec2> positions) {
         std::vector<vec2> world_positions;
 
         // Convert positions to grid positions
@@ -82,19 +89,19 @@ public:
             world_positions.push_back(world_pos);
         }
 
-        return createPatrolEnemy(renderer, world_positions);
+        return createPatrolEnemy(world, renderer, world_positions);
     }
 
-    static entt::entity createMousetrapAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createMousetrapAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createMousetrap(renderer, vec2(x_pos, y_pos));
+        return createMousetrap(world, renderer, vec2(x_pos, y_pos));
     }
 
-    static entt::entity createBoomerangAtGridPos(RenderSystem* renderer, vec2 grid_pos) {
+    static entt::entity createBoomerangAtGridPos(World& world, RenderSystem* renderer, vec2 grid_pos) {
         int x_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[0] * GRID_CELL_WIDTH_PX);
         int y_pos = GRID_CELL_WIDTH_PX / 2 + (grid_pos[1] * GRID_CELL_HEIGHT_PX);
-        return createBoomerang(renderer, vec2(x_pos, y_pos), BOOMERANG_SIZE, vec2(0,0), HARMFUL_DAMAGE, vec2(x_pos, y_pos), vec2(x_pos, y_pos),
+        return createBoomerang(world, renderer, vec2(x_pos, y_pos), BOOMERANG_SIZE, vec2(0,0), HARMFUL_DAMAGE, vec2(x_pos, y_pos), vec2(x_pos, y_pos),
             vec2(x_pos + (5 * GRID_CELL_WIDTH_PX), y_pos - (7 * GRID_CELL_HEIGHT_PX)), 
             vec2(x_pos - (5 * GRID_CELL_WIDTH_PX), y_pos - (7 * GRID_CELL_HEIGHT_PX))
             );
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "map_system.hpp"
+#include "tinyECS/registry.hpp"
+#include "util/rng.hpp"
+
+// One simulation: its entities, the level map and the run state its systems share.
+// Systems take the World they work on when they are constructed and the world_init
+// factories take it as their first argument; nothing in here is global. Separate Worlds,
+// e.g. headless replays or level tests, can therefore run at the same time on different
+// threads. A single World belongs to one thread at a time, apart from the jobs its own
+// systems hand to the job system.
+class World {
+public:
+    explicit World(uint64_t seed) : random(seed) {}
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    entt::registry registry;
+    MapSystem map_system;
+    RandomStreams random;
+
+    // game clock in seconds, advanced by the main loop rather than read from glfwGetTime,
+    // so headless runs get the same timing without a GLFW context
+    double gameTime() const { return game_time_s; }
+    void advanceTime(float elapsed_ms) { game_time_s += elapsed_ms / 1000.0; }
+
+    // the portal wall next to the player, found by the physics step for teleporting
+    bool can_teleport = false;
+    entt::entity nearby_player_entity = entt::null;
+    entt::entity nearby_wall_entity = entt::null;
+
+private:
+    double game_time_s = 0.0;
+};
@@ -3,34 +3,35 @@
 #include "map_system.hpp"
 #include "tinyECS/registry.hpp"
 #include "world_system.hpp"
+#include "util/logger.hpp"
 #include <iostream>
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // !!! TODO A1: implement grid lines as gridLines with renderRequests and colors
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-entt::entity createPlayer(RenderSystem* renderer, vec2 position)
+entt::entity createPlayer(World& world, RenderSystem* renderer, vec2 position)
 {
 	// reserve an entity
-	auto entity = registry.create();
+	auto entity = world.registry.create();
 
 	// invader
-	Player& player = registry.emplace<Player>(entity);
+	Player& player = world.registry.emplace<Player>(entity);
 	player.health = 10;
 	player.keys = 0;
 
-	Animation& animation = registry.emplace<Animation>(entity);
+	Animation& animation = world.registry.emplace<Animation>(entity);
 	animation.loops = true;
-	animation.cur_frame_start_time = (float)(glfwGetTime() * 10.0f);
+	animation.cur_frame_start_time = (float)(world.gameTime() * 10.0f);
 	animation.cur_ind = int(TEXTURE_ASSET_ID::MOUSE_4_EAST);
 	animation.start_ind = int(TEXTURE_ASSET_ID::MOUSE_4_EAST);
 	animation.end_ind = int(TEXTURE_ASSET_ID::MOUSE_6_EAST);
 
 	// store a reference to the potentially re-used mesh object
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::CHICKEN);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
 	// TODO A1: initialize the position, scale, and physics components
-	auto& motion = registry.emplace<Motion>(entity);
+	auto& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
@@ -40,8 +41,8 @@ entt::entity createPlayer(RenderSystem* renderer, vec2 position)
 	motion.scale = vec2({ INVADER_BB_WIDTH, INVADER_BB_HEIGHT });
 
 	// create an (empty) Bug component to be able to refer to all bug
-	registry.emplace<Eatable>(entity);
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<Eatable>(entity);
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID(animation.cur_ind),
 		EFFECT_ASSET_ID::TEXTURED,
@@ -52,21 +53,21 @@ entt::entity createPlayer(RenderSystem* renderer, vec2 position)
 	return entity;
 }
 
-entt::entity createPortalBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity)
+entt::entity createPortalBullet(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity)
 {
-	auto entity = registry.create();
-	registry.emplace<Projectile>(entity);
+	auto entity = world.registry.create();
+	world.registry.emplace<Projectile>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = velocity;
 	motion.position = pos;
 	motion.scale = size;
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::PROJECTILE);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::PROJECTILE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -77,16 +78,16 @@ entt::entity createPortalBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec
 	return entity;
 }
 
-entt::entity createWeaponIndicator(vec2 pos, float rotation) {
-	auto entity = registry.create();
-	registry.emplace<WeaponIndicator>(entity);
+entt::entity createWeaponIndicator(World& world, vec2 pos, float rotation) {
+	auto entity = world.registry.create();
+	world.registry.emplace<WeaponIndicator>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.position = pos;
 	motion.angle = rotation;
 	motion.scale = {20, 20};
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::WEAPON_INDICATOR,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -97,10 +98,10 @@ entt::entity createWeaponIndicator(vec2 pos, float rotation) {
 	return entity;
 }
 
-entt::entity createText(std::string text, vec2 pos, vec2 scale) {
-	auto entity = registry.create();
+entt::entity createText(World& world, std::string text, vec2 pos, vec2 scale) {
+	auto entity = world.registry.create();
 
-	TextRenderRequest& rr = registry.emplace<TextRenderRequest>(entity);
+	TextRenderRequest& rr = world.registry.emplace<TextRenderRequest>(entity);
 	rr.position = pos;
 	rr.scale = scale;
 	rr.text = text;
@@ -108,17 +109,16 @@ entt::entity createText(std::string text, vec2 pos, vec2 scale) {
 	return entity;
 }
 
-entt::entity createSkipButton(vec2 pos, vec2 scale) {
-	std::cout << "Creating skip button" << std::endl;
-	auto entity = registry.create();
-	registry.emplace<SkipButton>(entity);
+entt::entity createSkipButton(World& world, vec2 pos, vec2 scale) {
+	auto entity = world.registry.create();
+	world.registry.emplace<SkipButton>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.position = pos;
 	motion.scale = scale;
 	motion.velocity = {0, 0};
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::SKIP_BUTTON, 
 		EFFECT_ASSET_ID::TEXTURED,
@@ -126,29 +126,29 @@ entt::entity createSkipButton(vec2 pos, vec2 scale) {
 		11
 	);
 
-	std::cout << "Button created at: (" << pos.x << ", " << pos.y << ")" << std::endl;
+	LOG_DEBUG("Skip button created at: (%.1f, %.1f)", pos.x, pos.y);
 
 	return entity;
 }
 
 
-entt::entity createExplosion(vec2 pos) {
-	entt::entity entity = registry.create();
+entt::entity createExplosion(World& world, vec2 pos) {
+	entt::entity entity = world.registry.create();
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.position = pos;
 	motion.scale = {50, 50};
 
-	Animation& animation = registry.emplace<Animation>(entity);
-	animation.cur_frame_start_time = (float)(glfwGetTime() * 10.0f);
+	Animation& animation = world.registry.emplace<Animation>(entity);
+	animation.cur_frame_start_time = (float)(world.gameTime() * 10.0f);
 	animation.start_ind = int(TEXTURE_ASSET_ID::EXPLOSION_1);
 	animation.end_ind = int(TEXTURE_ASSET_ID::EXPLOSION_3);
 	animation.cur_ind = int(TEXTURE_ASSET_ID::EXPLOSION_1);
 	animation.loops = false;
 
-	registry.emplace<Explosion>(entity);
+	world.registry.emplace<Explosion>(entity);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::EXPLOSION_1,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -159,21 +159,21 @@ entt::entity createExplosion(vec2 pos) {
 	return entity;
 }
 
-entt::entity createNWEWall(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createNWEWall(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Wall>(entity);
+	world.registry.emplace<Wall>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::NWE_WALL,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -186,21 +186,21 @@ entt::entity createNWEWall(RenderSystem* renderer, vec2 position) {
 }
 
 
-entt::entity createSouthWall(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createSouthWall(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Wall>(entity);
+	world.registry.emplace<Wall>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::SOUTH_WALL,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -213,18 +213,18 @@ entt::entity createSouthWall(RenderSystem* renderer, vec2 position) {
 }
 
 
-entt::entity createFloorTile(vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createFloorTile(World& world, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Floor>(entity);
+	world.registry.emplace<Floor>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::FLOOR_TILE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -237,18 +237,18 @@ entt::entity createFloorTile(vec2 position) {
 }
 
 
-entt::entity createBlankTile(vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createBlankTile(World& world, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Wall>(entity);
+	world.registry.emplace<Wall>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::BLANK_TILE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -260,22 +260,22 @@ entt::entity createBlankTile(vec2 position) {
 	return entity;
 }
 
-entt::entity createDoor(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createDoor(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	Door &door = registry.emplace<Door>(entity);
+	Door &door = world.registry.emplace<Door>(entity);
 	door.locked = true;
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::CLOSED_DOOR,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -285,21 +285,21 @@ entt::entity createDoor(RenderSystem* renderer, vec2 position) {
 	return entity;
 }
 
-entt::entity createExit(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createExit(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Exit>(entity);
+	world.registry.emplace<Exit>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::CLOSED_EXIT,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -309,21 +309,21 @@ entt::entity createExit(RenderSystem* renderer, vec2 position) {
 	return entity;
 }
 
-entt::entity createKey(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createKey(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Key>(entity);
+	world.registry.emplace<Key>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::KEY,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -333,21 +333,21 @@ entt::entity createKey(RenderSystem* renderer, vec2 position) {
 	return entity;
 }
 
-entt::entity createFloorIce(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createFloorIce(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<FloorIce>(entity);
+	world.registry.emplace<FloorIce>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::ICE_TILE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -358,22 +358,22 @@ entt::entity createFloorIce(RenderSystem* renderer, vec2 position) {
 }
 
 
-entt::entity createCheese(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createCheese(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	Cheese &cheese = registry.emplace<Cheese>(entity);
+	Cheese &cheese = world.registry.emplace<Cheese>(entity);
 	cheese.points = CHEESE_POINTS;
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::MOUSETRAP);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::CHEESE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -384,24 +384,24 @@ entt::entity createCheese(RenderSystem* renderer, vec2 position) {
 	return entity;
 }
 
-entt::entity createMousetrap(RenderSystem* renderer, vec2 position) {
-	entt::entity entity = registry.create();
+entt::entity createMousetrap(World& world, RenderSystem* renderer, vec2 position) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Mousetrap>(entity);
+	world.registry.emplace<Mousetrap>(entity);
 
-	Harmful& harmful = registry.emplace<Harmful>(entity);
+	Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = HARMFUL_DAMAGE;
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = position;
 	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::MOUSETRAP);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::MOUSETRAP,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -412,20 +412,83 @@ entt::entity createMousetrap(RenderSystem* renderer, vec2 position) {
 	return entity;
 }
 
-entt::entity createPortal(RenderSystem* renderer, vec2 position, vec2 scale, int direction, std::optional<entt::entity> previous_portal) {
-	entt::entity entity = registry.create();
+// one grid cell, not moving, drawn as a textured sprite
+static Prefab tilePrefab(TEXTURE_ASSET_ID texture, int z) {
+	Motion motion;
+	motion.angle = 0.f;
+	motion.velocity = { 0, 0 };
+	motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
-	Portal &portal = registry.emplace<Portal>(entity);
+	Prefab prefab(motion);
+	prefab.with<RenderRequest>({ texture, EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE, z });
+	return prefab;
+}
+
+const Prefab& getPrefab(RenderSystem* renderer, PREFAB_ID id) {
+	// per thread, so worlds built on different threads never rebuild each other's table
+	thread_local std::vector<Prefab> prefabs;
+	thread_local RenderSystem* prefabs_renderer = nullptr;
+
+	// the collision meshes belong to the renderer
+	if (prefabs_renderer != renderer) {
+		MeshPtr everything = &renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
+		MeshPtr mousetrap = &renderer->getMesh(GEOMETRY_BUFFER_ID::MOUSETRAP);
+
+		// in PREFAB_ID order
+		prefabs.clear();
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::NWE_WALL, 2).with<Wall>().with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::SOUTH_WALL, 2).with<Wall>().with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::FLOOR_TILE, 0).with<Floor>());
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::ICE_TILE, 1).with<FloorIce>().with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::CLOSED_DOOR, 1).with<Door>({ true }).with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::CLOSED_EXIT, 1).with<Exit>().with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::KEY, 1).with<Key>().with<MeshPtr>(everything));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::CHEESE, 1).with<Cheese>({ CHEESE_POINTS }).with<MeshPtr>(mousetrap));
+		prefabs.push_back(tilePrefab(TEXTURE_ASSET_ID::MOUSETRAP, 1).with<Mousetrap>().with<Harmful>({ HARMFUL_DAMAGE }).with<MeshPtr>(mousetrap));
+		prefabs_renderer = renderer;
+	}
+	return prefabs[(int)id];
+}
+
+void trackLevelComponents(Snapshot& snapshot) {
+	snapshot
+		.track<Motion>()
+		.track<RenderRequest>()
+		.track<MeshPtr>()
+		.track<Animation>()
+		.track<Player>()
+		.track<Harmful>()
+		.track<Eatable>()
+		.track<Cat>()
+		.track<Sniper>()
+		.track<Patrol>()
+		.track<PatrolWalking>()
+		.track<Boid>()
+		.track<Boomerang>()
+		.track<Wall>()
+		.track<Floor>()
+		.track<FloorIce>()
+		.track<Door>()
+		.track<Key>()
+		.track<Exit>()
+		.track<Cheese>()
+		.track<Mousetrap>();
+}
+
+entt::entity createPortal(World& world, RenderSystem* renderer, vec2 position, vec2 scale, int direction, std::optional<entt::entity> previous_portal) {
+	entt::entity entity = world.registry.create();
+
+	Portal &portal = world.registry.emplace<Portal>(entity);
 	portal.direction = direction;
 	portal.position = position;
 	
 	if (previous_portal.has_value()) {
 		portal.other_portal = previous_portal.value();
-		Portal &portal_other = registry.get<Portal>(previous_portal.value());
+		Portal &portal_other = world.registry.get<Portal>(previous_portal.value());
 		portal_other.other_portal = entity;
 	}
 
-	Motion &motion = registry.emplace<Motion>(entity);
+	Motion &motion = world.registry.emplace<Motion>(entity);
 	
 	TEXTURE_ASSET_ID texture_id;
 	if (direction == Direction::TOP) {
@@ -450,9 +513,9 @@ entt::entity createPortal(RenderSystem* renderer, vec2 position, vec2 scale, int
 	motion.scale = scale;
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		texture_id,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -463,30 +526,31 @@ entt::entity createPortal(RenderSystem* renderer, vec2 position, vec2 scale, int
 	return entity;
 }
 
-entt::entity createPatrolEnemy(RenderSystem* renderer, std::vector<vec2> positions) {
-    entt::entity entity = registry.create();
+entt::entity createPatrolEnemy(World& world, RenderSystem* renderer, std::vector<vec2> positions) {
+    entt::entity entity = world.registry.create();
 
-	Harmful& harmful = registry.emplace<Harmful>(entity);
+	Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = HARMFUL_DAMAGE;
 
-	registry.emplace<Cat>(entity);
+	world.registry.emplace<Cat>(entity);
 
-    Motion& motion = registry.emplace<Motion>(entity);
+    Motion& motion = world.registry.emplace<Motion>(entity);
     motion.position = positions[0]; 
     motion.velocity = { 0, 0 };
     motion.scale = vec2({ GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX });
 
-    Patrol& patrol = registry.emplace<Patrol>(entity);
+    Patrol& patrol = world.registry.emplace<Patrol>(entity);
     for (vec2 pos : positions) {
         patrol.waypoints.push_back(pos);
     }
 
     patrol.currentTargetIndex = 0; 
+    world.registry.emplace<PatrolWalking>(entity);
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::MOUSETRAP);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-    registry.emplace<RenderRequest>(
+    world.registry.emplace<RenderRequest>(
         entity,
         TEXTURE_ASSET_ID::PATROL_CAT_1_WEST, 
         EFFECT_ASSET_ID::TEXTURED,
@@ -495,36 +559,36 @@ entt::entity createPatrolEnemy(RenderSystem* renderer, std::vector<vec2> positio
     );
 
 	Animation anim;
-    anim.cur_frame_start_time = (float)(glfwGetTime() * 10.0f);
+    anim.cur_frame_start_time = (float)(world.gameTime() * 10.0f);
     anim.cur_ind = (int)TEXTURE_ASSET_ID::PATROL_CAT_1_WEST;
     anim.start_ind = (int)TEXTURE_ASSET_ID::PATROL_CAT_1_WEST;
     anim.end_ind = (int)TEXTURE_ASSET_ID::PATROL_CAT_3_WEST;
     anim.loops = true;
-    registry.emplace<Animation>(entity, anim);
+    world.registry.emplace<Animation>(entity, anim);
 
     return entity;
 }
 
-entt::entity createSniperEnemy(RenderSystem* renderer, vec2 position, Direction direction)
+entt::entity createSniperEnemy(World& world, RenderSystem* renderer, vec2 position, Direction direction)
 {
-	auto entity = registry.create();
+	auto entity = world.registry.create();
 
 	// new tower
-	Sniper& sniper = registry.emplace<Sniper>(entity);
+	Sniper& sniper = world.registry.emplace<Sniper>(entity);
 	sniper.timer_ms = SNIPER_TIMER_MS;
 	sniper.direction = direction;
 	
-	registry.emplace<Cat>(entity);
+	world.registry.emplace<Cat>(entity);
 
-	Harmful& harmful = registry.emplace<Harmful>(entity);
+	Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = HARMFUL_DAMAGE;
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
 	// Initialize the motion
-	auto& motion = registry.emplace<Motion>(entity);
+	auto& motion = world.registry.emplace<Motion>(entity);
 	if (direction == Direction::TOP) {
 		motion.angle = 0.0f;
 	} else if (direction == Direction::RIGHT) {
@@ -539,7 +603,7 @@ entt::entity createSniperEnemy(RenderSystem* renderer, vec2 position, Direction
 
 	motion.scale = vec2({ CAT_BB_WIDTH, CAT_BB_HEIGHT });
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::SNIPER_CAT_1,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -550,24 +614,24 @@ entt::entity createSniperEnemy(RenderSystem* renderer, vec2 position, Direction
 	return entity;
 }
 
-entt::entity createSniperBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage)
+entt::entity createSniperBullet(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage)
 {
-	auto entity = registry.create();
-	registry.emplace<SniperBullet>(entity);
+	auto entity = world.registry.create();
+	world.registry.emplace<SniperBullet>(entity);
 
-	Harmful& harmful = registry.emplace<Harmful>(entity);
+	Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = damage;
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = velocity;
 	motion.position = pos;
 	motion.scale = size;
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::EVERYTHING);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::PROJECTILE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -578,10 +642,10 @@ entt::entity createSniperBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec
 	return entity;
 }
 
-entt::entity createBoomerang(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage, vec2 start, vec2 end, vec2 control_start, vec2 control_end)
+entt::entity createBoomerang(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage, vec2 start, vec2 end, vec2 control_start, vec2 control_end)
 {
-	auto entity = registry.create();
-	Boomerang& boomerang = registry.emplace<Boomerang>(entity);
+	auto entity = world.registry.create();
+	Boomerang& boomerang = world.registry.emplace<Boomerang>(entity);
 	// bezier curve paramters
 	boomerang.start_pos = start;
 	boomerang.end_pos = end;
@@ -592,10 +656,10 @@ entt::entity createBoomerang(RenderSystem* renderer, vec2 pos, vec2 size, vec2 v
 	boomerang.reverse = false;   // Start in forward direction
 
 
-	Harmful& harmful = registry.emplace<Harmful>(entity);
+	Harmful& harmful = world.registry.emplace<Harmful>(entity);
 	harmful.damage = damage;
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = velocity;
 	motion.position = pos;
@@ -603,9 +667,9 @@ entt::entity createBoomerang(RenderSystem* renderer, vec2 pos, vec2 size, vec2 v
 	
 
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::PROJECTILE);
-	registry.emplace<MeshPtr>(entity, &mesh);
+	world.registry.emplace<MeshPtr>(entity, &mesh);
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		TEXTURE_ASSET_ID::BOMERANGE,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -616,18 +680,18 @@ entt::entity createBoomerang(RenderSystem* renderer, vec2 pos, vec2 size, vec2 v
 	return entity;
 }
 
-entt::entity createCutscene(int cutscene_index) {
-	entt::entity entity = registry.create();
+entt::entity createCutscene(World& world, int cutscene_index) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<Cutscene>(entity);
+	world.registry.emplace<Cutscene>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = { WINDOW_WIDTH_PX / 2, WINDOW_HEIGHT_PX / 2 };
 	motion.scale = { WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX };
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		static_cast<TEXTURE_ASSET_ID>(static_cast<int>(TEXTURE_ASSET_ID::CUTSCENE_1) + cutscene_index),
 		EFFECT_ASSET_ID::TEXTURED,
@@ -638,18 +702,18 @@ entt::entity createCutscene(int cutscene_index) {
 	return entity;
 }
 
-entt::entity createUI(RenderSystem* renderer, TEXTURE_ASSET_ID texture, int z) {
-	auto entity = registry.create();
+entt::entity createUI(World& world, RenderSystem* renderer, TEXTURE_ASSET_ID texture, int z) {
+	auto entity = world.registry.create();
 
-	registry.emplace<UI>(entity);
+	world.registry.emplace<UI>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = { WINDOW_WIDTH_PX / 2, WINDOW_HEIGHT_PX / 2 };
 	motion.scale = { WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX };
 
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		texture,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -660,12 +724,12 @@ entt::entity createUI(RenderSystem* renderer, TEXTURE_ASSET_ID texture, int z) {
 	return entity;
 }
 
-entt::entity createStartScreen() {
-	entt::entity entity = registry.create();
+entt::entity createStartScreen(World& world) {
+	entt::entity entity = world.registry.create();
 
-	registry.emplace<StartScreen>(entity);
+	world.registry.emplace<StartScreen>(entity);
 
-	Motion& motion = registry.emplace<Motion>(entity);
+	Motion& motion = world.registry.emplace<Motion>(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0, 0 };
 	motion.position = { WINDOW_WIDTH_PX / 2, WINDOW_HEIGHT_PX / 2 };
@@ -675,14 +739,14 @@ entt::entity createStartScreen() {
 	TEXTURE_ASSET_ID texture_id;
 
 	if (is_level_saved()) {
-		std::cout << "Level is not saved" << std::endl;
+		LOG_DEBUG("Level is not saved");
 		texture_id = TEXTURE_ASSET_ID::START_SCREEN;
 	} else {
-		std::cout << "Level is saved" << std::endl;
+		LOG_DEBUG("Level is saved");
 		texture_id = TEXTURE_ASSET_ID::START_SCREEN_2;
 	}
 	
-	registry.emplace<RenderRequest>(
+	world.registry.emplace<RenderRequest>(
 		entity,
 		texture_id,
 		EFFECT_ASSET_ID::TEXTURED,
@@ -698,7 +762,7 @@ bool is_level_saved() {
     
     // Check if file opened successfully
     if (!inFile.is_open()) {
-        std::cout << "Could not open file: " << std::endl;
+        LOG_DEBUG("Could not open saved level file");
         return true; // Treating unopenable files as empty
     }
     
@@ -707,11 +771,5 @@ bool is_level_saved() {
     
     inFile.close();
     
-    if (isEmpty) {
-        std::cout << "File is empty: " << std::endl;
-    } else {
-        std::cout << "File contains data: " << std::endl;
-    }
-    
     return !isEmpty;
 }
\ No newline at end of file
@@ -2,62 +2,87 @@
 
 #include "common.hpp"
 #include "render_system.hpp"
+#include "world.hpp"
+#include "tinyECS/prefab.hpp"
+#include "tinyECS/snapshot.hpp"
 #include <optional>
 
 // invaders
-entt::entity createPlayer(RenderSystem* renderer, vec2 position);
+entt::entity createPlayer(World& world, RenderSystem* renderer, vec2 position);
 
 // towers
-entt::entity createSniperEnemy(RenderSystem* renderer, vec2 position, Direction direction);
+entt::entity createSniperEnemy(World& world, RenderSystem* renderer, vec2 position, Direction direction);
 
-entt::entity createSniperBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage);
+entt::entity createSniperBullet(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage);
 
-entt::entity createPortalBullet(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity);
+entt::entity createPortalBullet(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity);
 
-entt::entity createBoomerang(RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage, vec2 start, vec2 end, vec2 control_start, vec2 control_end);
+entt::entity createBoomerang(World& world, RenderSystem* renderer, vec2 pos, vec2 size, vec2 velocity, int damage, vec2 start, vec2 end, vec2 control_start, vec2 control_end);
 
-entt::entity createWeaponIndicator(vec2 pos, float rotation);
+entt::entity createWeaponIndicator(World& world, vec2 pos, float rotation);
 
-entt::entity createPortal(RenderSystem* renderer, vec2 position, vec2 scale, int direction, std::optional<entt::entity> previous_portal = std::nullopt);
+entt::entity createPortal(World& world, RenderSystem* renderer, vec2 position, vec2 scale, int direction, std::optional<entt::entity> previous_portal = std::nullopt);
 
-entt::entity createText(std::string text, vec2 pos, vec2 scale);
+entt::entity createText(World& world, std::string text, vec2 pos, vec2 scale);
 
-entt::entity createSkipButton(vec2 pos, vec2 scale);
+entt::entity createSkipButton(World& world, vec2 pos, vec2 scale);
 
-entt::entity createExplosion(vec2 pos);
+entt::entity createExplosion(World& world, vec2 pos);
 
-entt::entity createNWEWall(RenderSystem* renderer, vec2 position);
+entt::entity createNWEWall(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createSouthWall(RenderSystem* renderer, vec2 position);
+entt::entity createSouthWall(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createFloorTile(vec2 position);
+entt::entity createFloorTile(World& world, vec2 position);
 
-entt::entity createBlankTile(vec2 position);
+entt::entity createBlankTile(World& world, vec2 position);
 
-entt::entity createDoor(RenderSystem* renderer, vec2 position);
+entt::entity createDoor(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createExit(RenderSystem* renderer, vec2 position);
+entt::entity createExit(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createKey(RenderSystem* renderer, vec2 position);
+entt::entity createKey(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createFloorIce(RenderSystem* renderer, vec2 position);
+entt::entity createFloorIce(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createCheese(RenderSystem* renderer, vec2 position);
+entt::entity createCheese(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createPatrolEnemy(RenderSystem* renderer, std::vector<vec2> positions);
+entt::entity createPatrolEnemy(World& world, RenderSystem* renderer, std::vector<vec2> positions);
 
-entt::entity createPatrolRangeIndicator(entt::entity owner, vec2 position);
+entt::entity createPatrolRangeIndicator(World& world, entt::entity owner, vec2 position);
 
-entt::entity createMousetrap(RenderSystem* renderer, vec2 position);
+entt::entity createMousetrap(World& world, RenderSystem* renderer, vec2 position);
 
-entt::entity createCutscene(int cutscene_index);
+entt::entity createCutscene(World& world, int cutscene_index);
 
-entt::entity createUI(RenderSystem* renderer, TEXTURE_ASSET_ID texture, int z);
+entt::entity createUI(World& world, RenderSystem* renderer, TEXTURE_ASSET_ID texture, int z);
 
-entt::entity createStartScreen();
+entt::entity createStartScreen(World& world);
+
+// level tiles and pickups as prefabs, for building a level in one batch; each has the
+// components its create* factory above emplaces
+enum class PREFAB_ID {
+	NWE_WALL = 0,
+	SOUTH_WALL = NWE_WALL + 1,
+	FLOOR = SOUTH_WALL + 1,
+	FLOOR_ICE = FLOOR + 1,
+	DOOR = FLOOR_ICE + 1,
+	EXIT = DOOR + 1,
+	KEY = EXIT + 1,
+	CHEESE = KEY + 1,
+	MOUSETRAP = CHEESE + 1,
+	PREFAB_COUNT = MOUSETRAP + 1
+};
+const int prefab_count = (int)PREFAB_ID::PREFAB_COUNT;
+
+const Prefab& getPrefab(RenderSystem* renderer, PREFAB_ID id);
+
+// registers with snapshot every component the level factories (map tiles, player, cats,
+// pickups, boids) put on an entity, so a freshly built level can be captured
+void trackLevelComponents(Snapshot& snapshot);
 
 // legacy
 // the player
-entt::entity createChicken(RenderSystem* renderer, vec2 position);
+entt::entity createChicken(World& world, RenderSystem* renderer, vec2 position);
 
 bool is_level_saved();
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "world_init.hpp"
 #include "util/world_grid.hpp"
 #include <tuple> 
+#include <algorithm>
 
 // stlib
 #include <cassert>
@@ -12,21 +13,15 @@
 #include <entt.hpp>
 
 #include "physics_system.hpp"
-#include "map_system.hpp"
-#include "boids_system.hpp"
-
-#include "tinyECS/registry.hpp"
-
-
-bool WorldSystem::can_teleport = false;
-entt::entity WorldSystem::nearby_player_entity = entt::null;
-entt::entity WorldSystem::nearby_wall_entity = entt::null;
-
-// map
-MapSystem map_system;
+#include "util/logger.hpp"
+#include "util/perf_counters.hpp"
+#include "util/profiler.hpp"
 
 // create the world
-WorldSystem::WorldSystem() :
+WorldSystem::WorldSystem(World& world) :
+	world(world),
+	commands(world.registry),
+	boids(world),
 	next_invader_spawn(0),
 	invader_spawn_rate_ms(INVADER_SPAWN_RATE_MS),
 	max_towers(MAX_TOWERS_START),
@@ -36,10 +31,9 @@ WorldSystem::WorldSystem() :
 	level_points(0),
 	past_points(0),
 	level(0),
+	level_snapshot(world.registry),
 	current_cutscene(0)
 {
-	// seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
 }
 
 WorldSystem::~WorldSystem() {
@@ -54,25 +48,28 @@ WorldSystem::~WorldSystem() {
 		Mix_FreeChunk(key_collect_sound);
 	if (portal_sound != nullptr)
 		Mix_FreeChunk(portal_sound);
-	Mix_CloseAudio();
+	if (audio_open)
+		Mix_CloseAudio();
 
 	// Destroy all created components
-	registry.clear();
+	world.registry.clear();
 
 	// Close the window
-	glfwDestroyWindow(window);
+	if (window != nullptr)
+		glfwDestroyWindow(window);
 }
 
 // Debugging
 namespace {
 	void glfw_err_cb(int error, const char *desc) {
-		std::cerr << error << ": " << desc << std::endl;
+		LOG_ERROR("GLFW %d: %s", error, desc);
 	}
 }
 
 // call to close the window, wrapper around GLFW commands
 void WorldSystem::close_window() {
-	glfwSetWindowShouldClose(window, GLFW_TRUE);
+	if (window != nullptr)
+		glfwSetWindowShouldClose(window, GLFW_TRUE);
 }
 
 // World initialization
@@ -83,7 +80,7 @@ GLFWwindow* WorldSystem::create_window() {
 	// Initialize GLFW
 	glfwSetErrorCallback(glfw_err_cb);
 	if (!glfwInit()) {
-		std::cerr << "ERROR: Failed to initialize GLFW in world_system.cpp" << std::endl;
+		LOG_ERROR("Failed to initialize GLFW in world_system.cpp");
 		return nullptr;
 	}
 
@@ -106,7 +103,7 @@ GLFWwindow* WorldSystem::create_window() {
 	// Create the main window (for rendering, keyboard, and mouse input)
 	window = glfwCreateWindow(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX, "Towers vs Invaders Assignment", nullptr, nullptr);
 	if (window == nullptr) {
-		std::cerr << "ERROR: Failed to glfwCreateWindow in world_system.cpp" << std::endl;
+		LOG_ERROR("Failed to glfwCreateWindow in world_system.cpp");
 		return nullptr;
 	}
 
@@ -116,9 +113,29 @@ GLFWwindow* WorldSystem::create_window() {
 	glfwSetWindowUserPointer(window, this);
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
 
-	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_key(_0, _1, _2, _3); };
-	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_mouse_move({ _0, _1 }); };
-	auto mouse_button_pressed_redirect = [](GLFWwindow* wnd, int _button, int _action, int _mods) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_mouse_button_pressed(_button, _action, _mods); };
+	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) {
+		InputEvent event;
+		event.type = InputEventType::KEY;
+		event.code = _0;
+		event.action = _2;
+		event.mods = _3;
+		((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_window_input(event);
+	};
+	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) {
+		InputEvent event;
+		event.type = InputEventType::MOUSE_MOVE;
+		event.x = (float)_0;
+		event.y = (float)_1;
+		((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_window_input(event);
+	};
+	auto mouse_button_pressed_redirect = [](GLFWwindow* wnd, int _button, int _action, int _mods) {
+		InputEvent event;
+		event.type = InputEventType::MOUSE_BUTTON;
+		event.code = _button;
+		event.action = _action;
+		event.mods = _mods;
+		((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_window_input(event);
+	};
 	
 	
 	glfwSetKeyCallback(window, key_redirect);
@@ -133,14 +150,15 @@ bool WorldSystem::start_and_load_sounds() {
 	//////////////////////////////////////
 	// Loading music and sounds with SDL
 	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-		fprintf(stderr, "Failed to initialize SDL Audio");
+		LOG_ERROR("Failed to initialize SDL Audio");
 		return false;
 	}
 
 	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
-		fprintf(stderr, "Failed to open audio device");
+		LOG_ERROR("Failed to open audio device");
 		return false;
 	}
+	audio_open = true;
 
 	background_music = Mix_LoadMUS(audio_path("music.wav").c_str());
 	chicken_dead_sound = Mix_LoadWAV(audio_path("chicken_dead.wav").c_str());
@@ -149,7 +167,7 @@ bool WorldSystem::start_and_load_sounds() {
 	portal_sound = Mix_LoadWAV(audio_path("portal.wav").c_str());
 
 	if (background_music == nullptr || chicken_dead_sound == nullptr || chicken_eat_sound == nullptr || key_collect_sound == nullptr || portal_sound == nullptr) {
-		fprintf(stderr, "Failed to load sounds\n %s\n %s\n %s\n make sure the data directory is present",
+		LOG_ERROR("Failed to load sounds\n %s\n %s\n %s\n %s\n %s\n make sure the data directory is present",
 			audio_path("music.wav").c_str(),
 			audio_path("chicken_dead.wav").c_str(),
 			audio_path("chicken_eat.wav").c_str(),
@@ -162,28 +180,66 @@ bool WorldSystem::start_and_load_sounds() {
 }
 
 void WorldSystem::generate_level() {
-	std::cout << "LOADING LEVEL " << level << std::endl;
+	LOG_INFO("Loading level %u", level);
 
 	// this implemetation is temporary for now; will be replaced by our map placement system
 	int start_portals;
 	if (level < 12) {	
-		start_portals = map_system.loadLevel(level);
+		start_portals = world.map_system.loadLevel(level);
 		max_portals = start_portals;
 		portal_charge = start_portals;
-		player_entity = map_system.createLevel(renderer);
+		player_entity = world.map_system.createLevel(world, renderer);
 
-		if (std::get<0>(map_system.levels[level]) == "boss_map.csv") {
-			BoidsSystem::createBoidsFlock(renderer, vec2(WINDOW_WIDTH_PX / 2, WINDOW_HEIGHT_PX / 2), 100.0f, 20);
+		if (std::get<0>(world.map_system.levels[level]) == "boss_map.csv") {
+			BoidsSystem::createBoidsFlock(world, renderer, vec2(WINDOW_WIDTH_PX / 2, WINDOW_HEIGHT_PX / 2), 100.0f, 20);
 		}
 		
 
 	} else {
 		max_portals = 2;
 		portal_charge = 2;
-		player_entity = WorldGrid::createPlayerAtGridPos(renderer, vec2(1,1));
+		player_entity = WorldGrid::createPlayerAtGridPos(world, renderer, vec2(1,1));
+
+		WorldGrid::createKeyAtGridPos(world, renderer, vec2(0,0));
+		WorldGrid::createExitAtGridPos(world, renderer, vec2(13,9));
+	}
+}
+
+// keeps the level entities generate_level just created for the next restart
+void WorldSystem::capture_level() {
+	snapshot_level = -1;
+
+	// the entities restart_game destroys
+	std::vector<entt::entity> entities;
+	for (auto entity : world.registry.view<Motion>()) {
+		if (!world.registry.all_of<UI>(entity)) {
+			entities.push_back(entity);
+		}
+	}
+	auto player = std::find(entities.begin(), entities.end(), player_entity);
+	if (player == entities.end() || !level_snapshot.capture(entities)) {
+		level_snapshot.clear();
+		return;
+	}
+
+	snapshot_level = (int)level;
+	snapshot_player = player - entities.begin();
+	snapshot_portals = max_portals;
+}
+
+// recreates the level as capture_level saw it, in place of generate_level
+void WorldSystem::restore_level() {
+	LOG_INFO("Restoring level %u", level);
 
-		WorldGrid::createKeyAtGridPos(renderer, vec2(0,0));
-		WorldGrid::createExitAtGridPos(renderer, vec2(13,9));
+	std::vector<entt::entity> entities;
+	level_snapshot.restore(entities);
+	player_entity = entities[snapshot_player];
+	max_portals = snapshot_portals;
+	portal_charge = snapshot_portals;
+
+	// doors opened and portals placed since the load are gone again
+	if (level < 12) {
+		world.map_system.resetLevel();
 	}
 }
 
@@ -191,11 +247,14 @@ void WorldSystem::init(RenderSystem* renderer_arg) {
 
 	this->renderer = renderer_arg;
 
+	trackLevelComponents(level_snapshot);
+
 	// start playing background music indefinitely
-	std::cout << "Starting music..." << std::endl;
+	LOG_DEBUG("Starting music...");
 
 	// Background Music
-	Mix_PlayMusic(background_music, -1);
+	if (background_music != nullptr)
+		Mix_PlayMusic(background_music, -1);
 
 	// Init UI
 	initUI(renderer_arg);
@@ -206,28 +265,50 @@ void WorldSystem::init(RenderSystem* renderer_arg) {
 
 void WorldSystem::initUI(RenderSystem* renderer_arg) {
 	// UI
-	stats_ui = createUI(renderer_arg, TEXTURE_ASSET_ID::BACKGROUND_UI, -1);
-	tutorial_ui = createUI(renderer_arg, TEXTURE_ASSET_ID::TUTORIAL_UI, 10);
+	stats_ui = createUI(world, renderer_arg, TEXTURE_ASSET_ID::BACKGROUND_UI, -1);
+	tutorial_ui = createUI(world, renderer_arg, TEXTURE_ASSET_ID::TUTORIAL_UI, 10);
 
 	// text renderer
 	renderer_arg->load_font();
 	glm::vec2 text_scale(TEXT_WIDTH, TEXT_HEIGHT);
 
-	entt::entity cheese_text = createText("0", glm::vec2(140, 70), text_scale);
-	cheese_trr = &registry.get<TextRenderRequest>(cheese_text);
+	entt::entity cheese_text = createText(world, "0", glm::vec2(140, 70), text_scale);
+	cheese_trr = &world.registry.get<TextRenderRequest>(cheese_text);
+
+	entt::entity keys_text = createText(world, "0", glm::vec2(420, 70), text_scale);
+	keys_trr = &world.registry.get<TextRenderRequest>(keys_text);
+
+	entt::entity portal_charge_text = createText(world, "0", glm::vec2(680, 70), text_scale);
+	portal_charge_trr = &world.registry.get<TextRenderRequest>(portal_charge_text);
 
-	entt::entity keys_text = createText("0", glm::vec2(420, 70), text_scale);
-	keys_trr = &registry.get<TextRenderRequest>(keys_text);
+	std::string level_text = world.map_system.getLevelText(0);
+	entt::entity entity = createText(world, level_text, glm::vec2(50, 760), text_scale);
+	level_text_trr = &world.registry.get<TextRenderRequest>(entity);
 
-	entt::entity portal_charge_text = createText("0", glm::vec2(680, 70), text_scale);
-	portal_charge_trr = &registry.get<TextRenderRequest>(portal_charge_text);
+	entt::entity fps_text = createText(world, "0", glm::vec2(1024, 60), text_scale);
+	fps_trr = &world.registry.get<TextRenderRequest>(fps_text);
 
-	std::string level_text = map_system.getLevelText(0);
-	entt::entity entity = createText(level_text, glm::vec2(50, 760), text_scale);
-	level_text_trr = &registry.get<TextRenderRequest>(entity);
+	// per-system frame times, toggled with F3
+	entt::entity profile_text = createText(world, "", glm::vec2(50, 860), text_scale * 0.5f);
+	profile_trr = &world.registry.get<TextRenderRequest>(profile_text);
+}
+
+void WorldSystem::play_level(unsigned int level_index) {
+	// same as continuing a saved game from the start screen
+	for (auto entity : world.registry.view<StartScreen>()) {
+		world.registry.destroy(entity);
+	}
+	update_cutscene = 6;
+	game_screen = GAME_SCREEN_ID::PLAYING;
+	level = level_index;
+	restart_game();
+}
 
-	entt::entity fps_text = createText("0", glm::vec2(1024, 60), text_scale);
-	fps_trr = &registry.get<TextRenderRequest>(fps_text);
+void WorldSystem::play_sound(Mix_Chunk* sound) {
+	// counted even without audio, so headless runs report the same
+	PerfCounters::add(PerfCounter::SOUNDS_PLAYED);
+	if (sound != nullptr)
+		Mix_PlayChannel(-1, sound, 0);
 }
 
 // Update Custcenes if updated scene
@@ -235,9 +316,9 @@ bool WorldSystem::cutsceneStep() {
 	// magic number for cutscene count
 	if (update_cutscene > 5) {
 		game_screen = GAME_SCREEN_ID::PLAYING;
-		auto cutscene_view = registry.view<Cutscene>();
+		auto cutscene_view = world.registry.view<Cutscene>();
 		for (auto entity : cutscene_view) {
-			registry.destroy(entity);
+			world.registry.destroy(entity);
 		}
 
 		restart_game();
@@ -245,11 +326,11 @@ bool WorldSystem::cutsceneStep() {
 	}
 	if (update_cutscene != current_cutscene) {
 
-		auto cutscene_view = registry.view<Cutscene>();
+		auto cutscene_view = world.registry.view<Cutscene>();
 		for (auto entity : cutscene_view) {
-			registry.destroy(entity);
+			world.registry.destroy(entity);
 		}
-		entt::entity new_cutscene = createCutscene(current_cutscene);
+		entt::entity new_cutscene = createCutscene(world, current_cutscene);
 
 		current_cutscene++;
 		return true;
@@ -260,29 +341,28 @@ bool WorldSystem::cutsceneStep() {
 // Init the Start Screen
 bool WorldSystem::startScreenStep() {
 	if (game_screen == GAME_SCREEN_ID::START_SCREEN) {
-		auto start_screen_view = registry.view<StartScreen>();
+		auto start_screen_view = world.registry.view<StartScreen>();
 		if (start_screen_view.empty()) {
-			entt::entity start_screen = createStartScreen();
+			entt::entity start_screen = createStartScreen(world);
 		}
 		if (key_state.find(GLFW_KEY_S) != key_state.end()) {
-			std::cout << "Starting game..." << std::endl;
+			LOG_INFO("Starting game...");
 			game_screen = GAME_SCREEN_ID::CUTSCENE;
 			clear_saved_level(world_level_filename);
 			for (auto entity : start_screen_view) {
-				registry.destroy(entity);
+				world.registry.destroy(entity);
 			}
 		}
 
 		if (key_state.find(GLFW_KEY_C) != key_state.end() && has_saved_level(world_level_filename)) {
-			std::cout << "Starting playing..." << std::endl;
+			LOG_INFO("Starting playing...");
 			update_cutscene = 6;
 			for (auto entity : start_screen_view) {
-				registry.destroy(entity);
+				world.registry.destroy(entity);
 			}
 			game_screen = GAME_SCREEN_ID::PLAYING;
 			get_saved_level(world_level_filename, level);
 			restart_game();
-			std::cout << level << std::endl;
 			return false;
 		}
 		return true;
@@ -291,11 +371,10 @@ bool WorldSystem::startScreenStep() {
 
 bool WorldSystem::save_level(const std::string& filename) {
     std::ofstream outFile(user_Path(filename));
-    std::cout << filename << std::endl;
     if (!outFile.is_open()) {
         return false;
     }
-    std::cout << "Saving level " << level << " to " << filename << std::endl;
+    LOG_INFO("Saving level %u to %s", level, filename.c_str());
 
     // Write the level with proper formatting
     outFile << level << std::endl; 
@@ -308,7 +387,7 @@ bool WorldSystem::has_saved_level(const std::string& filename) {
     std::ifstream inFile(user_Path(filename));
     
     if (!inFile.is_open()) {
-        std::cout << "Could not open file: " << filename << std::endl;
+        LOG_WARN("Could not open file: %s", filename.c_str());
         return false;
     }
     
@@ -316,7 +395,6 @@ bool WorldSystem::has_saved_level(const std::string& filename) {
     std::streampos fileSize = inFile.tellg();
     inFile.close();
     
-	std::cout << fileSize << std::endl;
     return (fileSize > 0);
 }
 
@@ -325,18 +403,18 @@ bool WorldSystem::get_saved_level(const std::string& filename, unsigned int& lev
     
     // Check if file opened successfully
     if (!inFile.is_open()) {
-        std::cout << "Could not open file: " << filename << std::endl;
+        LOG_WARN("Could not open file: %s", filename.c_str());
         return false;
     }
     
     // Try to read the number
     if (inFile >> level) {
         inFile.close();
-        std::cout << "Successfully read level " << level << " from " << filename << std::endl;
+        LOG_INFO("Successfully read level %u from %s", level, filename.c_str());
         return true;
     } else {
         inFile.close();
-        std::cout << "Failed to read level from " << filename << std::endl;
+        LOG_WARN("Failed to read level from %s", filename.c_str());
         return false;
     }
 }
@@ -346,12 +424,12 @@ bool WorldSystem::clear_saved_level(const std::string& filename) {
     std::ofstream outFile(user_Path(filename), std::ios::trunc);
     
     if (!outFile.is_open()) {
-        std::cout << "Could not open file for clearing: " << filename << std::endl;
+        LOG_WARN("Could not open file for clearing: %s", filename.c_str());
         return false;
     }
     
     outFile.close();
-    std::cout << "Successfully cleared file: " << filename << std::endl;
+    LOG_DEBUG("Successfully cleared file: %s", filename.c_str());
     return true;
 }
 
@@ -360,82 +438,87 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	// Updating window title with points
 	std::stringstream title_ss;
 	title_ss << "Points: " << level_points + past_points; // total_points = level_points + past_points
-	glfwSetWindowTitle(window, title_ss.str().c_str());
+	if (window != nullptr)
+		glfwSetWindowTitle(window, title_ss.str().c_str());
 
 	// update player movement
 	update_player_movement(elapsed_ms_since_last_update);
 
 	// Removing out of screen entities
-	auto motion_view = registry.view<Motion>();
+	auto motion_view = world.registry.view<Motion>();
 
 	for (auto entity : motion_view) {
-	    Motion& motion = registry.get<Motion>(entity);
+	    Motion& motion = world.registry.get<Motion>(entity);
 		if (motion.position.x + abs(motion.scale.x) < 0.f ||
 			motion.position.x > WINDOW_WIDTH_PX || 
 			motion.position.y + abs(motion.scale.y) < 0.f ||
 			motion.position.y > WINDOW_HEIGHT_PX) {
-			if(!registry.any_of<Player, WeaponIndicator>(entity)) // don't remove the player
-				registry.destroy(entity);
+			if(!world.registry.any_of<Player, WeaponIndicator>(entity)) // don't remove the player
+				commands.destroy(entity);
 		}
 	}
 
-	auto render_request_view = registry.view<RenderRequest>();
+	auto render_request_view = world.registry.view<RenderRequest>();
 	for (entt::entity entity : render_request_view) {
-		if (registry.all_of<Animation>(entity)) {
-			Animation& animation = registry.get<Animation>(entity);
-			if (registry.all_of<Explosion>(entity)) {
+		if (world.registry.all_of<Animation>(entity)) {
+			Animation& animation = world.registry.get<Animation>(entity);
+			if (world.registry.all_of<Explosion>(entity)) {
 				if (animation.cur_ind > animation.end_ind) {
 					// delete explosions
-					registry.destroy(entity);
+					commands.destroy(entity);
 					continue;
 				}
 			}
 
 			// do not animate any other entities except explosion if darken_screen_factor >= 0
 			// darken_screen_factor >= 0 only if the player dies
-			ScreenState& screenState = registry.get<ScreenState>(renderer->get_screen_state_entity());
-			if (screenState.darken_screen_factor >= 0 && !registry.all_of<Explosion>(entity)) {
+			ScreenState& screenState = world.registry.get<ScreenState>(renderer->get_screen_state_entity());
+			if (screenState.darken_screen_factor >= 0 && !world.registry.all_of<Explosion>(entity)) {
 				continue;
 			}
 
-			float time = (float)(glfwGetTime() * 10.0f);
+			float time = (float)(world.gameTime() * 10.0f);
 			if (time - animation.cur_frame_start_time > FRAME_DURATION) {
 				if (animation.cur_ind < animation.start_ind || animation.cur_ind > animation.end_ind) {
 					animation.cur_ind = animation.start_ind;
 				}
 				animation.cur_ind += 1;
-				animation.cur_frame_start_time = (float)(glfwGetTime() * 10.0f);
+				animation.cur_frame_start_time = (float)(world.gameTime() * 10.0f);
 				if (animation.cur_ind > animation.end_ind && animation.loops) {
 					animation.cur_ind = animation.start_ind;
 				}
-				RenderRequest& render_request = registry.get<RenderRequest>(entity);
+				RenderRequest& render_request = world.registry.get<RenderRequest>(entity);
 				render_request.used_texture = TEXTURE_ASSET_ID(animation.cur_ind);
 			}
 		}
 	}
 
+	// sync point: nothing is iterating, apply the removals recorded above
+	commands.playback();
+
 	// update weapon indicator
-	if (registry.all_of<WeaponIndicator>(weapon_indicator_entity)) { // 
-		vec2 player_pos = registry.get<Motion>(player_entity).position;
+	if (world.registry.all_of<WeaponIndicator>(weapon_indicator_entity)) { // 
+		vec2 player_pos = world.registry.get<Motion>(player_entity).position;
 		vec2 mouse_dir = normalize(vec2(mouse_pos_x, mouse_pos_y) - player_pos);
 		vec2 indicator_pos = player_pos + (mouse_dir * WEAPON_INDICATOR_SPACING);
 
-		Motion &indicator_motion = registry.get<Motion>(weapon_indicator_entity);
+		Motion &indicator_motion = world.registry.get<Motion>(weapon_indicator_entity);
 		indicator_motion.position = indicator_pos;
 		float indicator_angle = 90 + atan2(mouse_dir.y, mouse_dir.x) * 180 / M_PI;
 		indicator_motion.angle = indicator_angle;
 	}
 
 	// update cheese and keys count
-	if (!registry.view<Player>().empty()) {
+	if (!world.registry.view<Player>().empty()) {
 		cheese_trr->text = std::to_string(level_points + past_points);
-		keys_trr->text = std::to_string(registry.get<Player>(player_entity).keys);
+		keys_trr->text = std::to_string(world.registry.get<Player>(player_entity).keys);
 		portal_charge_trr->text = std::to_string(portal_charge);
 		fps_trr->text = std::to_string(int(1000 / elapsed_ms_since_last_update));
 	}
+	profile_trr->text = show_profile ? Profiler::summary() : "";
 
 	// update boids swarm
-	BoidsSystem::updateBoids(elapsed_ms_since_last_update);
+	boids.updateBoids(elapsed_ms_since_last_update);
 
 	return true;
 }
@@ -443,7 +526,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 // Reset the world state to its initial state
 void WorldSystem::restart_game() {
 
-	std::cout << "Restarting..." << std::endl;
+	LOG_INFO("Restarting...");
 
 	// Reset the game speed
 	current_speed = 1.f;
@@ -460,14 +543,14 @@ void WorldSystem::restart_game() {
 	// Remove all entities that we created
 	// All that have a motion, we could also iterate over all bug, eagles, ... but that would be more cumbersome
 
-	auto motion_view = registry.view<Motion>();
+	auto motion_view = world.registry.view<Motion>();
 	for (auto entity : motion_view) {
-		if (!registry.all_of<UI>(entity)) {
-			registry.destroy(entity);
+		if (!world.registry.all_of<UI>(entity)) {
+			world.registry.destroy(entity);
 		}
 	}
 
-	ScreenState& screenState = registry.get<ScreenState>(renderer->get_screen_state_entity());
+	ScreenState& screenState = world.registry.get<ScreenState>(renderer->get_screen_state_entity());
 	screenState.darken_screen_factor = -1;
 	screenState.show_vignette = false;
 	max_towers = 5;
@@ -476,55 +559,60 @@ void WorldSystem::restart_game() {
 	// clear keys
 	key_state.clear();
 
-	// generate level
-	WorldSystem::generate_level();
+	// generate level, or put back the copy taken when it was last generated
+	if (snapshot_level == (int)level) {
+		restore_level();
+	} else {
+		WorldSystem::generate_level();
+		capture_level();
+	}
 
 	// create weapon indicator
-	vec2 player_pos = registry.get<Motion>(player_entity).position;
-	weapon_indicator_entity = createWeaponIndicator(player_pos, 0);	
+	vec2 player_pos = world.registry.get<Motion>(player_entity).position;
+	weapon_indicator_entity = createWeaponIndicator(world, player_pos, 0);	
 
 	// reset count UI
 	cheese_trr->text = "0";
 	keys_trr->text = "0";
-	level_text_trr->text = map_system.getLevelText(level);
-	if (level >= map_system.getNumTutorialLevels()) {
-		if (registry.valid(tutorial_ui)) {
-			registry.destroy(tutorial_ui);
+	level_text_trr->text = world.map_system.getLevelText(level);
+	if (level >= world.map_system.getNumTutorialLevels()) {
+		if (world.registry.valid(tutorial_ui)) {
+			world.registry.destroy(tutorial_ui);
 		}
 	}
 
 	if (level == 0 && game_screen == GAME_SCREEN_ID::PLAYING) {
-		createSkipButton({WINDOW_WIDTH_PX - 100, WINDOW_HEIGHT_PX - 75}, {100, 50}); 
+		createSkipButton(world, {WINDOW_WIDTH_PX - 100, WINDOW_HEIGHT_PX - 75}, {100, 50}); 
 	} 
 }
 
 bool WorldSystem::handle_player_harmful_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_harmful_1 = registry.all_of<Harmful>(entity1);
-	bool is_harmful_2 = registry.all_of<Harmful>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_harmful_1 = world.registry.all_of<Harmful>(entity1);
+	bool is_harmful_2 = world.registry.all_of<Harmful>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_harmful_1 && is_player_2) || (is_harmful_2 && is_player_1))) {
 		entt::entity player_entity = is_player_1 ? entity1 : entity2;
 		entt::entity harmful_entity = is_harmful_1 ? entity1 : entity2;
 
-		Player& player_component = registry.get<Player>(player_entity);
-		Harmful& harmful_component = registry.get<Harmful>(harmful_entity);
+		Player& player_component = world.registry.get<Player>(player_entity);
+		Harmful& harmful_component = world.registry.get<Harmful>(harmful_entity);
 		player_component.health -= harmful_component.damage;
 	
 		if (player_component.health <= 0) {
-			Mix_PlayChannel(-1, chicken_dead_sound, 0);
+			play_sound(chicken_dead_sound);
 			// replace invader component with explosion component
 
 			// set explosion velocity to 0
-			Motion& motion = registry.get<Motion>(player_entity);
+			Motion& motion = world.registry.get<Motion>(player_entity);
 			vec2 explosion_position = motion.position;
 
-			createExplosion(explosion_position);
-			registry.destroy(player_entity);
-			registry.destroy(weapon_indicator_entity);
+			commands.defer([this, explosion_position]() { createExplosion(world, explosion_position); });
+			commands.destroy(player_entity);
+			commands.destroy(weapon_indicator_entity);
 
-			renderer->set_death_time(glfwGetTime() * 10.0f);
+			renderer->set_death_time(world.gameTime() * 10.0f);
 			darken_screen();
 
 			return true;
@@ -536,12 +624,12 @@ bool WorldSystem::handle_player_harmful_collisions(entt::entity entity1, entt::e
 
 void WorldSystem::handle_player_block_collisions(entt::entity player_entity, entt::entity block_entity) {
 	// get the wall's position and scale
-	Motion &wall_motion = registry.get<Motion>(block_entity);
+	Motion &wall_motion = world.registry.get<Motion>(block_entity);
 	vec2 &wall_scale = wall_motion.scale;
 	vec2 &wall_position = wall_motion.position;
 
 	// get the player's position, scale, and velocity
-	Motion &player_motion = registry.get<Motion>(player_entity);
+	Motion &player_motion = world.registry.get<Motion>(player_entity);
 	vec2 &player_scale = player_motion.scale;
 	vec2 &player_position = player_motion.position;
 
@@ -567,41 +655,41 @@ void WorldSystem::handle_player_block_collisions(entt::entity player_entity, ent
 
 void WorldSystem::handle_player_portal_collisions(entt::entity player_entity, entt::entity wall_with_portal_entity) {
 	// get the wall's position and scale
-	Motion &wall_motion = registry.get<Motion>(wall_with_portal_entity);
+	Motion &wall_motion = world.registry.get<Motion>(wall_with_portal_entity);
 	vec2 &wall_scale = wall_motion.scale;
 	vec2 &wall_position = wall_motion.position;
 
 	// get the player's position, scale, and velocity
-	Motion &player_motion = registry.get<Motion>(player_entity);
+	Motion &player_motion = world.registry.get<Motion>(player_entity);
 	vec2 &player_scale = player_motion.scale;
 	vec2 &player_position = player_motion.position;
 	vec2 &player_velocity = player_motion.velocity; 
 
 	// get the other portal
 	// TODO: @samzhao, abstract this logic to seperate func.
-	auto portal_view = registry.view<Portal>();
+	auto portal_view = world.registry.view<Portal>();
 	entt::entity current_portal_entity;
 	entt::entity other_portal_entity;
 	vec2 other_portal_position = {0, 0};
 	int other_portal_direction = 0;
 
 	for (entt::entity portal_entity : portal_view) {
-		Motion &portal_motion = registry.get<Motion>(portal_entity);
+		Motion &portal_motion = world.registry.get<Motion>(portal_entity);
 		vec2 &portal_position = portal_motion.position;
-		Portal &portal = registry.get<Portal>(portal_entity);
+		Portal &portal = world.registry.get<Portal>(portal_entity);
 
 		if (portal_position == wall_position) {
 			current_portal_entity = portal_entity;
 		}
 	}
-	Portal &portal = registry.get<Portal>(current_portal_entity);
+	Portal &portal = world.registry.get<Portal>(current_portal_entity);
 
-	if (registry.valid(portal.other_portal) && registry.all_of<Portal>(portal.other_portal)) {
-		Portal &other_portal_entity = registry.get<Portal>(portal.other_portal);
+	if (world.registry.valid(portal.other_portal) && world.registry.all_of<Portal>(portal.other_portal)) {
+		Portal &other_portal_entity = world.registry.get<Portal>(portal.other_portal);
 		other_portal_position = other_portal_entity.position;
 		other_portal_direction = other_portal_entity.direction;
 	} else {
-		std::cout << "ERROR: Other portal entity is invalid or does not have a Portal component!" << std::endl;
+		LOG_ERROR("Other portal entity is invalid or does not have a Portal component!");
 	}
 	
 	// calculate the new player position and spawn the player on the side the other portal faces
@@ -620,27 +708,27 @@ void WorldSystem::handle_player_portal_collisions(entt::entity player_entity, en
 }
 
 void WorldSystem::handle_player_wall_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_wall_1 = registry.all_of<Wall>(entity1);
-	bool is_wall_2 = registry.all_of<Wall>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_wall_1 = world.registry.all_of<Wall>(entity1);
+	bool is_wall_2 = world.registry.all_of<Wall>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_wall_1 && is_player_2) || (is_wall_2 && is_player_1))) {
 		entt::entity wall_entity = is_wall_1 ? entity1 : entity2;
-		Wall &wall = registry.get<Wall>(wall_entity);
+		Wall &wall = world.registry.get<Wall>(wall_entity);
 		entt::entity player_entity = is_player_1 ? entity1 : entity2;
 		entt::entity current_portal_entity;
-		Motion &wall_motion = registry.get<Motion>(wall_entity);
+		Motion &wall_motion = world.registry.get<Motion>(wall_entity);
 		vec2 &wall_scale = wall_motion.scale;
 		vec2 &wall_position = wall_motion.position;
 
 		// If the wall has a portal and there exists another portal corresponding to it, handle the collision differently
 		bool has_portal = wall.has_portal;
-		auto portal_view = registry.view<Portal>();
+		auto portal_view = world.registry.view<Portal>();
 
 		// if (has_portal) {
 		// 	for (entt::entity portal_entity : portal_view) {
-		// 		Motion &portal_motion = registry.get<Motion>(portal_entity);
+		// 		Motion &portal_motion = world.registry.get<Motion>(portal_entity);
 		// 		vec2 &portal_position = portal_motion.position;
 
 		// 		if (portal_position == wall_position) {
@@ -648,13 +736,13 @@ void WorldSystem::handle_player_wall_collisions(entt::entity entity1, entt::enti
 		// 		}
 		// 	}
 
-		// 	Portal &portal = registry.get<Portal>(current_portal_entity);
+		// 	Portal &portal = world.registry.get<Portal>(current_portal_entity);
 		// 	// Determine which direction the player came from as we need to handle direction in this fn.
-		// 	if (registry.valid(portal.other_portal) && registry.all_of<Portal>(portal.other_portal)) {
+		// 	if (world.registry.valid(portal.other_portal) && world.registry.all_of<Portal>(portal.other_portal)) {
 		// 		// get the wall's position and scale
 
 		// 		// get the player's position, scale, and velocity
-		// 		Motion &player_motion = registry.get<Motion>(player_entity);
+		// 		Motion &player_motion = world.registry.get<Motion>(player_entity);
 		// 		vec2 &player_position = player_motion.position;
 
 		// 		entt::entity current_portal_entity;
@@ -682,12 +770,12 @@ void WorldSystem::handle_player_wall_collisions(entt::entity entity1, entt::enti
 }
 
 void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::entity entity2) {
-    bool is_wall_1 = registry.all_of<Wall>(entity1);
-    bool is_wall_2 = registry.all_of<Wall>(entity2);
-	bool is_portal_bullet_1 = registry.all_of<Projectile>(entity1);
-	bool is_portal_bullet_2 = registry.all_of<Projectile>(entity2);
-	bool is_sniper_bullet_1 = registry.all_of<SniperBullet>(entity1);
-	bool is_sniper_bullet_2 = registry.all_of<SniperBullet>(entity2);
+    bool is_wall_1 = world.registry.all_of<Wall>(entity1);
+    bool is_wall_2 = world.registry.all_of<Wall>(entity2);
+	bool is_portal_bullet_1 = world.registry.all_of<Projectile>(entity1);
+	bool is_portal_bullet_2 = world.registry.all_of<Projectile>(entity2);
+	bool is_sniper_bullet_1 = world.registry.all_of<SniperBullet>(entity1);
+	bool is_sniper_bullet_2 = world.registry.all_of<SniperBullet>(entity2);
     bool is_projectile_1 = is_portal_bullet_1 || is_sniper_bullet_1;
 	bool is_projectile_2 = is_portal_bullet_2 || is_sniper_bullet_2;
 
@@ -695,21 +783,21 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
         entt::entity wall_entity = is_wall_1 ? entity1 : entity2;
         entt::entity projectile_entity = is_projectile_1 ? entity1 : entity2;
 
-		Wall &wall = registry.get<Wall>(wall_entity);
+		Wall &wall = world.registry.get<Wall>(wall_entity);
 		bool has_portal = wall.has_portal;
 
         // Get the wall's position and scale
-        Motion &wall_motion = registry.get<Motion>(wall_entity);
+        Motion &wall_motion = world.registry.get<Motion>(wall_entity);
         vec2 &wall_scale = wall_motion.scale;
         vec2 &wall_position = wall_motion.position;
 
         // Get the projectile's position, scale, and velocity
-        Motion &projectile_motion = registry.get<Motion>(projectile_entity);
+        Motion &projectile_motion = world.registry.get<Motion>(projectile_entity);
         vec2 &projectile_scale = projectile_motion.scale;
         vec2 &projectile_position = projectile_motion.position;
 
 		// Check if the wall has a portal
-		auto portal_view = registry.view<Portal>();
+		auto portal_view = world.registry.view<Portal>();
 		if (has_portal) {
 			entt::entity portal_entity;
 			vec2 other_portal_position = {0.f, 0.f};
@@ -717,7 +805,7 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
 
 			// Get the portal entity
 			for (entt::entity portal : portal_view) {
-				Motion &portal_motion = registry.get<Motion>(portal);
+				Motion &portal_motion = world.registry.get<Motion>(portal);
 				vec2 &portal_position = portal_motion.position;
 
 				if (portal_position == wall_position) {
@@ -725,17 +813,16 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
 				}
 			}
 			// Check if there is another portal
-			Portal &portal = registry.get<Portal>(portal_entity);
-			std::cout << "Checking for other portal" << std::endl;
+			Portal &portal = world.registry.get<Portal>(portal_entity);
+			LOG_TRACE("Checking for other portal");
 			
-			if (registry.valid(portal.other_portal) && registry.all_of<Portal>(portal.other_portal) && (is_sniper_bullet_1 || is_sniper_bullet_2)) {
-				Portal &other_portal_entity = registry.get<Portal>(portal.other_portal);
+			if (world.registry.valid(portal.other_portal) && world.registry.all_of<Portal>(portal.other_portal) && (is_sniper_bullet_1 || is_sniper_bullet_2)) {
+				Portal &other_portal_entity = world.registry.get<Portal>(portal.other_portal);
 				other_portal_position = other_portal_entity.position;
 				direction = other_portal_entity.direction;
 			} else {
-				registry.destroy(projectile_entity);
+				commands.destroy(projectile_entity);
 				return;
-				std::cout << "ERROR: Other portal entity is invalid or does not have a Portal component!" << std::endl;
 			}
 
 			
@@ -743,7 +830,7 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
 			vec2 new_projectile_position = other_portal_position;
 
 			float bullet_speed = PORTAL_BULLET_SPEED;
-			if (registry.all_of<SniperBullet>(projectile_entity)) {
+			if (world.registry.all_of<SniperBullet>(projectile_entity)) {
 				bullet_speed = SNIPER_BULLET_SPEED;
 			}
 			// Set the new projectiles velocity based on direction the portal is facing
@@ -762,11 +849,13 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
 			}
 
 			// Only want to create sniper bullet through portals
-			if (registry.all_of<SniperBullet>(projectile_entity)) {
-				Harmful &harmful = registry.get<Harmful>(projectile_entity);
-				createSniperBullet(renderer, new_projectile_position, projectile_scale, new_projectile_velocity, harmful.damage);
+			if (world.registry.all_of<SniperBullet>(projectile_entity)) {
+				Harmful &harmful = world.registry.get<Harmful>(projectile_entity);
+				commands.defer([this, renderer = renderer, new_projectile_position, scale = projectile_scale, new_projectile_velocity, damage = harmful.damage]() {
+					createSniperBullet(world, renderer, new_projectile_position, scale, new_projectile_velocity, damage);
+				});
 			}
-			registry.destroy(projectile_entity);
+			commands.destroy(projectile_entity);
 			return;
 		}
 
@@ -777,44 +866,47 @@ void WorldSystem::handle_bullet_wall_collisions(entt::entity entity1, entt::enti
 
 		if (portal_charge > 0) {
 			if (wall.has_portal) {
-				registry.destroy(projectile_entity);
+				commands.destroy(projectile_entity);
 				return;
 			}
-			if (registry.all_of<Projectile>(projectile_entity)) {
-				if (!has_opening_portal_placed) {
-					createPortal(renderer, wall_position, wall_scale, direction);
-					has_opening_portal_placed = true;
-				} else {
-					// Get the most recent portal placed and connect it to the current portal
-					if (portal_view.size() > 0) {
-						std::cout << "Found previous portal" << std::endl;
-						entt::entity previous_portal_entity = *(portal_view.begin());
-						for (entt::entity portal : portal_view) {
-							Portal &portal_pos = registry.get<Portal>(portal);
-						}
-						createPortal(renderer, wall_position, wall_scale, direction, previous_portal_entity);
-						has_opening_portal_placed = false;
+			if (world.registry.all_of<Projectile>(projectile_entity)) {
+				// created at playback, so a second portal this frame still pairs with the first
+				commands.defer([this, wall_position = wall_position, wall_scale = wall_scale, direction]() {
+					auto portal_view = world.registry.view<Portal>();
+					if (!has_opening_portal_placed) {
+						createPortal(world, renderer, wall_position, wall_scale, direction);
+						has_opening_portal_placed = true;
 					} else {
-						std::cout << "Error: No previous portal found" << std::endl;
+						// Get the most recent portal placed and connect it to the current portal
+						if (portal_view.size() > 0) {
+							LOG_TRACE("Found previous portal");
+							entt::entity previous_portal_entity = *(portal_view.begin());
+							createPortal(world, renderer, wall_position, wall_scale, direction, previous_portal_entity);
+							has_opening_portal_placed = false;
+						} else {
+							LOG_ERROR("No previous portal found");
+						}
 					}
-				}
+					// new teleport edge for pathfinding, now that the portal exists
+					world.map_system.updatePortalGraph(world.registry);
+				});
 				portal_charge -= 1;
 				wall.has_portal = true;
 			}
 		}
 
         // Destroy the projectile on impact of the wall
-        registry.destroy(projectile_entity);
+        commands.destroy(projectile_entity);
     }
 }
 
 void WorldSystem::handle_bullet_door_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_door_1 = registry.all_of<Door>(entity1);
-	bool is_door_2 = registry.all_of<Door>(entity2);
-	bool is_portal_bullet_1 = registry.all_of<Projectile>(entity1);
-	bool is_portal_bullet_2 = registry.all_of<Projectile>(entity2);
-	bool is_sniper_bullet_1 = registry.all_of<SniperBullet>(entity1);
-	bool is_sniper_bullet_2 = registry.all_of<SniperBullet>(entity2);
+	bool is_door_1 = world.registry.all_of<Door>(entity1);
+	bool is_door_2 = world.registry.all_of<Door>(entity2);
+	bool is_portal_bullet_1 = world.registry.all_of<Projectile>(entity1);
+	bool is_portal_bullet_2 = world.registry.all_of<Projectile>(entity2);
+	bool is_sniper_bullet_1 = world.registry.all_of<SniperBullet>(entity1);
+	bool is_sniper_bullet_2 = world.registry.all_of<SniperBullet>(entity2);
     bool is_projectile_1 = is_portal_bullet_1 || is_sniper_bullet_1;
 	bool is_projectile_2 = is_portal_bullet_2 || is_sniper_bullet_2;
 
@@ -822,78 +914,82 @@ void WorldSystem::handle_bullet_door_collisions(entt::entity entity1, entt::enti
 		entt::entity door_entity = is_door_1 ? entity1 : entity2;
 		entt::entity projectile_entity = is_projectile_1 ? entity1 : entity2;
 
-		Door &door = registry.get<Door>(door_entity);
+		Door &door = world.registry.get<Door>(door_entity);
 		if (door.locked) {
-			registry.destroy(projectile_entity);
+			commands.destroy(projectile_entity);
 		}
 	}
 }
 
 void WorldSystem::handle_bullet_exit_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_exit_1 = registry.all_of<Exit>(entity1);
-	bool is_exit_2 = registry.all_of<Exit>(entity2);
-	bool is_portal_bullet_1 = registry.all_of<Projectile>(entity1);
-	bool is_portal_bullet_2 = registry.all_of<Projectile>(entity2);
-	bool is_sniper_bullet_1 = registry.all_of<SniperBullet>(entity1);
-	bool is_sniper_bullet_2 = registry.all_of<SniperBullet>(entity2);
+	bool is_exit_1 = world.registry.all_of<Exit>(entity1);
+	bool is_exit_2 = world.registry.all_of<Exit>(entity2);
+	bool is_portal_bullet_1 = world.registry.all_of<Projectile>(entity1);
+	bool is_portal_bullet_2 = world.registry.all_of<Projectile>(entity2);
+	bool is_sniper_bullet_1 = world.registry.all_of<SniperBullet>(entity1);
+	bool is_sniper_bullet_2 = world.registry.all_of<SniperBullet>(entity2);
     bool is_projectile_1 = is_portal_bullet_1 || is_sniper_bullet_1;
 	bool is_projectile_2 = is_portal_bullet_2 || is_sniper_bullet_2;
 
 	if ((is_exit_1 && is_projectile_2) || (is_exit_2 && is_projectile_1)) {
 		entt::entity projectile_entity = is_projectile_1 ? entity1 : entity2;
 
-		registry.destroy(projectile_entity);
+		commands.destroy(projectile_entity);
 	}
 }
 
 void WorldSystem::handle_sniper_bullet_cat_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_cat_1 = registry.all_of<Cat>(entity1);
-	bool is_cat_2 = registry.all_of<Cat>(entity2);
-	bool is_bullet_1 = registry.all_of<SniperBullet>(entity1);
-	bool is_bullet_2 = registry.all_of<SniperBullet>(entity2);
+	bool is_cat_1 = world.registry.all_of<Cat>(entity1);
+	bool is_cat_2 = world.registry.all_of<Cat>(entity2);
+	bool is_bullet_1 = world.registry.all_of<SniperBullet>(entity1);
+	bool is_bullet_2 = world.registry.all_of<SniperBullet>(entity2);
 
 	if ((is_cat_1 && is_bullet_2) || (is_cat_2 && is_bullet_1)) {
 		entt::entity cat_entity = is_cat_1 ? entity1 : entity2;
 		entt::entity bullet_entity = is_bullet_1 ? entity1 : entity2;
 
-		createExplosion(registry.get<Motion>(cat_entity).position);
-		registry.destroy(bullet_entity);
-		registry.destroy(cat_entity);
+		vec2 explosion_position = world.registry.get<Motion>(cat_entity).position;
+		commands.defer([this, explosion_position]() { createExplosion(world, explosion_position); });
+		commands.destroy(bullet_entity);
+		commands.destroy(cat_entity);
 	}
 }
 
 void WorldSystem::handle_portal_bullet_cat_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_cat_1 = registry.all_of<Cat>(entity1);
-	bool is_cat_2 = registry.all_of<Cat>(entity2);
-	bool is_bullet_1 = registry.all_of<Projectile>(entity1);
-	bool is_bullet_2 = registry.all_of<Projectile>(entity2);
+	bool is_cat_1 = world.registry.all_of<Cat>(entity1);
+	bool is_cat_2 = world.registry.all_of<Cat>(entity2);
+	bool is_bullet_1 = world.registry.all_of<Projectile>(entity1);
+	bool is_bullet_2 = world.registry.all_of<Projectile>(entity2);
 
 	if ((is_cat_1 && is_bullet_2) || (is_cat_2 && is_bullet_1)) {
 		entt::entity cat_entity = is_cat_1 ? entity1 : entity2;
 		entt::entity bullet_entity = is_bullet_1 ? entity1 : entity2;
 
-		registry.destroy(bullet_entity);
+		commands.destroy(bullet_entity);
 	}
 }
 
 void WorldSystem::handle_player_door_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_door_1 = registry.all_of<Door>(entity1);
-	bool is_door_2 = registry.all_of<Door>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_door_1 = world.registry.all_of<Door>(entity1);
+	bool is_door_2 = world.registry.all_of<Door>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_door_1 && is_player_2) || (is_door_2 && is_player_1))) {
 		entt::entity door_entity = is_door_1 ? entity1 : entity2;
 		entt::entity player_entity = is_player_1 ? entity1 : entity2;
 
-		Door &door = registry.get<Door>(door_entity);
+		Door &door = world.registry.get<Door>(door_entity);
 		if (door.locked) {
-			Player &player = registry.get<Player>(player_entity);
+			Player &player = world.registry.get<Player>(player_entity);
 			if (player.keys > 0) {
-				RenderRequest &request = registry.get<RenderRequest>(door_entity);
+				RenderRequest &request = world.registry.get<RenderRequest>(door_entity);
 				request.used_texture = TEXTURE_ASSET_ID::OPEN_DOOR;
 				player.keys -= 1;
 				door.locked = false;
+
+				vec2 door_pos = world.registry.get<Motion>(door_entity).position;
+				world.map_system.setDoorOpen(ivec2(door_pos.x / GRID_CELL_WIDTH_PX, door_pos.y / GRID_CELL_HEIGHT_PX), true);
 			} else {
 				handle_player_block_collisions(player_entity, door_entity);
 			}
@@ -902,16 +998,17 @@ void WorldSystem::handle_player_door_collisions(entt::entity entity1, entt::enti
 }
 
 bool WorldSystem::handle_player_exit_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_exit_1 = registry.all_of<Exit>(entity1);
-	bool is_exit_2 = registry.all_of<Exit>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_exit_1 = world.registry.all_of<Exit>(entity1);
+	bool is_exit_2 = world.registry.all_of<Exit>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
-	if (((is_exit_1 && is_player_2) || (is_exit_2 && is_player_1))) {
+	// a player touching two exit tiles still advances one level
+	if (!restart_pending && ((is_exit_1 && is_player_2) || (is_exit_2 && is_player_1))) {
 		level += 1;
 		past_points += level_points;
 		level_points = 0;
-		restart_game();
+		restart_pending = true;
 		return true;
 	}
 
@@ -919,28 +1016,28 @@ bool WorldSystem::handle_player_exit_collisions(entt::entity entity1, entt::enti
 }
 
 void WorldSystem::handle_player_key_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_key_1 = registry.all_of<Key>(entity1);
-	bool is_key_2 = registry.all_of<Key>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_key_1 = world.registry.all_of<Key>(entity1);
+	bool is_key_2 = world.registry.all_of<Key>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_key_1 && is_player_2) || (is_key_2 && is_player_1))) {
 		entt::entity key_entity = is_key_1 ? entity1 : entity2;
 		entt::entity player_entity = is_player_1 ? entity1 : entity2;
 
-		Player &player = registry.get<Player>(player_entity);
+		Player &player = world.registry.get<Player>(player_entity);
 		player.keys += 1;
-		Mix_PlayChannel(-1, key_collect_sound, 0);
+		play_sound(key_collect_sound);
 
-		registry.destroy(key_entity);
+		commands.destroy(key_entity);
 	}
 }
 
 void WorldSystem::handle_player_ice_collisions(entt::entity entity1, entt::entity entity2, bool* is_on_ice) {
-	bool is_ice_1 = registry.all_of<FloorIce>(entity1);
-	bool is_ice_2 = registry.all_of<FloorIce>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_ice_1 = world.registry.all_of<FloorIce>(entity1);
+	bool is_ice_2 = world.registry.all_of<FloorIce>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_ice_1 && is_player_2) || (is_ice_2 && is_player_1))) {
 		entt::entity ice_entity = is_ice_1 ? entity1 : entity2;
@@ -951,41 +1048,43 @@ void WorldSystem::handle_player_ice_collisions(entt::entity entity1, entt::entit
 }
 
 void WorldSystem::handle_player_cheese_collisions(entt::entity entity1, entt::entity entity2) {
-	bool is_cheese_1 = registry.all_of<Cheese>(entity1);
-	bool is_cheese_2 = registry.all_of<Cheese>(entity2);
-	bool is_player_1 = registry.all_of<Player>(entity1);
-	bool is_player_2 = registry.all_of<Player>(entity2);
+	bool is_cheese_1 = world.registry.all_of<Cheese>(entity1);
+	bool is_cheese_2 = world.registry.all_of<Cheese>(entity2);
+	bool is_player_1 = world.registry.all_of<Player>(entity1);
+	bool is_player_2 = world.registry.all_of<Player>(entity2);
 
 	if (((is_cheese_1 && is_player_2) || (is_cheese_2 && is_player_1))) {
 		entt::entity cheese_entity = is_cheese_1 ? entity1 : entity2;
 		entt::entity player_entity = is_player_1 ? entity1 : entity2;
 
-		Cheese &cheese = registry.get<Cheese>(cheese_entity);
+		Cheese &cheese = world.registry.get<Cheese>(cheese_entity);
 		level_points += cheese.points;
-		Mix_PlayChannel(-1, chicken_eat_sound, 0);
+		play_sound(chicken_eat_sound);
 
-		registry.destroy(cheese_entity);
+		commands.destroy(cheese_entity);
 	}
 }
 
 void WorldSystem::darken_screen() {
-    ScreenState& screenState = registry.get<ScreenState>(renderer->get_screen_state_entity());
+    ScreenState& screenState = world.registry.get<ScreenState>(renderer->get_screen_state_entity());
     screenState.darken_screen_factor = 0; // set to 0 so that screen will start to darken
 }
 
 // Compute collisions between entities
 void WorldSystem::handle_collisions() {
-	auto collision_view = registry.view<Collision>();
-	auto proximity_view = registry.view<PortalProximity>();
+	auto collision_view = world.registry.view<Collision>();
+	auto proximity_view = world.registry.view<PortalProximity>();
 
 	bool is_on_ice = false;
 
-	bool player_died = false;
-	bool player_exited = false;
-
+	// Destruction, creation and the level restart are recorded and applied after the loop,
+	// so every contact is handled. A contact with an entity that an earlier one already
+	// destroyed is dropped.
 	for (auto collision : collision_view) {
-		entt::entity& entity1 = registry.get<Collision>(collision).entity1;
-        entt::entity& entity2 = registry.get<Collision>(collision).entity2;
+		entt::entity& entity1 = world.registry.get<Collision>(collision).entity1;
+        entt::entity& entity2 = world.registry.get<Collision>(collision).entity2;
+		if (commands.destroying(entity1) || commands.destroying(entity2))
+			continue;
 		
 		handle_player_wall_collisions(entity1, entity2);
 		handle_bullet_wall_collisions(entity1, entity2);
@@ -997,41 +1096,63 @@ void WorldSystem::handle_collisions() {
 		handle_player_cheese_collisions(entity1, entity2);
 		handle_sniper_bullet_cat_collisions(entity1, entity2);
 		handle_portal_bullet_cat_collisions(entity1, entity2);
-
-		// if player exits the level and call restart_game, or 
-		// if player dies and calls registry.destroy(entity),
-		// we should break from the loop since looping through the deleted entities would crash the game
-		player_died = handle_player_harmful_collisions(entity1, entity2);
-		if (player_died) {
-			break;
-		}
-		player_exited = handle_player_exit_collisions(entity1, entity2);
-		if (player_exited) {
-			break;
-		}
+		handle_player_harmful_collisions(entity1, entity2);
+		handle_player_exit_collisions(entity1, entity2);
 	}
 
 	for (auto proximity : proximity_view) {
-		entt::entity& entity1 = registry.get<PortalProximity>(proximity).entity1;
-		entt::entity& entity2 = registry.get<PortalProximity>(proximity).entity2;
+		entt::entity& entity1 = world.registry.get<PortalProximity>(proximity).entity1;
+		entt::entity& entity2 = world.registry.get<PortalProximity>(proximity).entity2;
 
 		handle_player_portal_collisions(entity1, entity2);
 	}
 
-	if (!player_died && !player_exited) {
-		Player &player = registry.get<Player>(player_entity);
+	if (!restart_pending && !commands.destroying(player_entity)) {
+		Player &player = world.registry.get<Player>(player_entity);
 		player.is_on_ice = is_on_ice;
 	} 
 	
 	// Remove all collisions from this simulation step
-	registry.clear<Collision>();
+	world.registry.clear<Collision>();
+
+	// sync point for everything the handlers recorded
+	commands.playback();
+	if (restart_pending) {
+		restart_pending = false;
+		restart_game();
+	}
 }
 
 // Should the game be over ?
 bool WorldSystem::is_over() const {
+	// headless runs are stopped by the caller
+	if (window == nullptr)
+		return false;
 	return bool(glfwWindowShouldClose(window));
 }
 
+void WorldSystem::on_window_input(const InputEvent& event) {
+	if (!ignore_window_input)
+		apply_input(event);
+}
+
+void WorldSystem::apply_input(const InputEvent& event) {
+	if (input_recorder != nullptr)
+		input_recorder->record(event);
+
+	switch (event.type) {
+		case InputEventType::KEY:
+			on_key(event.code, 0, event.action, event.mods);
+			break;
+		case InputEventType::MOUSE_MOVE:
+			on_mouse_move({ event.x, event.y });
+			break;
+		case InputEventType::MOUSE_BUTTON:
+			on_mouse_button_pressed(event.code, event.action, event.mods);
+			break;
+	}
+}
+
 // on key callback
 void WorldSystem::on_key(int key, int, int action, int mod) {
 
@@ -1042,9 +1163,6 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 
 	// Resetting game
 	if (action == GLFW_RELEASE && key == GLFW_KEY_R) {
-		int w, h;
-		glfwGetWindowSize(window, &w, &h);
-
         restart_game();
 	}
 		// SHIFT - record whether the SHIFT key is depressed or not to support macOS "right-click" --> SHIFT + left-click
@@ -1070,27 +1188,36 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		}
 	}
 
-	if (key == GLFW_KEY_SPACE && action == GLFW_RELEASE && can_teleport) {
-		handle_player_portal_collisions(nearby_player_entity, nearby_wall_entity);
+	if (key == GLFW_KEY_SPACE && action == GLFW_RELEASE && world.can_teleport) {
+		handle_player_portal_collisions(world.nearby_player_entity, world.nearby_wall_entity);
 	}
 
 	// K to save the level if you're playing
 	if (key == GLFW_KEY_K && game_screen == GAME_SCREEN_ID::PLAYING) {
 		if (action == GLFW_RELEASE) {
 			if (save_level(world_level_filename)) {
-				std::cout << "INFO: level saved to: " << world_level_filename << std::endl;
+				LOG_INFO("level saved to: %s", world_level_filename.c_str());
 			}
 			else {
-				std::cout << "ERROR: failed to save level: " << world_level_filename << std::endl;
+				LOG_ERROR("failed to save level: %s", world_level_filename.c_str());
 			}
 		}
 	}
 
+	// F3 shows the rolling per-system frame times, F9 dumps the recent frames as a Chrome trace and counter CSV
+	if (key == GLFW_KEY_F3 && action == GLFW_RELEASE) {
+		show_profile = !show_profile;
+	}
+	if (key == GLFW_KEY_F9 && action == GLFW_RELEASE) {
+		Profiler::exportChromeTrace(user_Path("trace.json"));
+		PerfCounters::dumpCsv(user_Path("counters.csv"));
+	}
+
 	const float speed = 200.f; // Adjust movement speed
-    if (registry.view<Player>().size() > 0) {
-        // entt::entity player = registry.players.entities[0];
-        // Motion& motion = registry.get<Motion>(player);
-		Animation& animation = registry.get<Animation>(player_entity);
+    if (world.registry.view<Player>().size() > 0) {
+        // entt::entity player = world.registry.players.entities[0];
+        // Motion& motion = world.registry.get<Motion>(player);
+		Animation& animation = world.registry.get<Animation>(player_entity);
 
 		if (action == GLFW_PRESS) {
         	key_state.insert(key);
@@ -1114,10 +1241,10 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 }
 
 void WorldSystem::update_player_movement(float elapsed_ms) {
-    if (registry.view<Player>().size() > 0) {
-		Player& player = registry.get<Player>(player_entity);
-        Motion& motion = registry.get<Motion>(player_entity);
-		Animation& animation = registry.get<Animation>(player_entity);
+    if (world.registry.view<Player>().size() > 0) {
+		Player& player = world.registry.get<Player>(player_entity);
+        Motion& motion = world.registry.get<Motion>(player_entity);
+		Animation& animation = world.registry.get<Animation>(player_entity);
 
 		float step_seconds = elapsed_ms / 1000.f;
 		float acceleration = (player.is_on_ice ? ICE_ACCEL : PLAYER_ACCEL) * elapsed_ms;
@@ -1176,11 +1303,11 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 	// TODO A1: Handle mouse clicking for invader and tower placement. [DONE]
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
-	ScreenState& screen_state = registry.get<ScreenState>(renderer->get_screen_state_entity());
+	ScreenState& screen_state = world.registry.get<ScreenState>(renderer->get_screen_state_entity());
 
 	if (game_screen == GAME_SCREEN_ID::CUTSCENE) {
 		if (action == GLFW_PRESS) {
-			std::cout << "next screen" << std::endl;
+			LOG_TRACE("next screen");
 			update_cutscene++;
 		}
 		return;
@@ -1189,10 +1316,10 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 	if (game_screen == GAME_SCREEN_ID::PLAYING && level == 0) {
 		if (action == GLFW_PRESS) {
 			vec2 mouse = {mouse_pos_x, mouse_pos_y};
-			auto skip_buttons = registry.view<SkipButton, Motion>();
+			auto skip_buttons = world.registry.view<SkipButton, Motion>();
 
 			for (auto entity : skip_buttons) {
-				Motion& motion = registry.get<Motion>(entity);
+				Motion& motion = world.registry.get<Motion>(entity);
 				vec2 pos = motion.position;
 				vec2 size = motion.scale;
 
@@ -1200,13 +1327,13 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 				if (mouse.x >= pos.x - size.x / 2 && mouse.x <= pos.x + size.x / 2 &&
 					mouse.y >= pos.y - size.y / 2 && mouse.y <= pos.y + size.y / 2) {
 
-					std::cout << "skip button pressed" << std::endl;
+					LOG_DEBUG("skip button pressed");
 
 					game_screen = GAME_SCREEN_ID::PLAYING;
 					level = 6;
 
 					for (auto b : skip_buttons) {
-						registry.destroy(b);
+						world.registry.destroy(b);
 					}
 					restart_game();
 					return;
@@ -1222,16 +1349,16 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 		int tile_x = (int)(mouse_pos_x / GRID_CELL_WIDTH_PX);
 		int tile_y = (int)(mouse_pos_y / GRID_CELL_HEIGHT_PX);
 
-		std::cout << "mouse position: " << mouse_pos_x << ", " << mouse_pos_y << std::endl;
-		std::cout << "mouse tile position: " << tile_x << ", " << tile_y << std::endl;
+		LOG_TRACE("mouse position: %.1f, %.1f", mouse_pos_x, mouse_pos_y);
+		LOG_TRACE("mouse tile position: %d, %d", tile_x, tile_y);
 
 		if (button == GLFW_MOUSE_BUTTON_LEFT && key_state.find(GLFW_KEY_LEFT_SHIFT) == key_state.end()) {
-			vec2 player_pos = registry.get<Motion>(player_entity).position;
+			vec2 player_pos = world.registry.get<Motion>(player_entity).position;
 			vec2 velocity = normalize(vec2(mouse_pos_x, mouse_pos_y) - player_pos) * PORTAL_BULLET_SPEED;
 
 			if (portal_charge != 0) { 
-				createPortalBullet(renderer, player_pos, PORTAL_PROJECTILE_SIZE, velocity);
-				Mix_PlayChannel(-1, portal_sound, 0);
+				createPortalBullet(world, renderer, player_pos, PORTAL_PROJECTILE_SIZE, velocity);
+				play_sound(portal_sound);
 			}
 		} 
 	}
@@ -1240,20 +1367,21 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 	if (button == GLFW_MOUSE_BUTTON_RIGHT || 
 		(button == GLFW_MOUSE_BUTTON_LEFT && key_state.find(GLFW_KEY_LEFT_SHIFT) != key_state.end()) || 
 		(button == GLFW_MOUSE_BUTTON_LEFT && key_state.find(GLFW_KEY_RIGHT_SHIFT) != key_state.end())) {
-		auto portal_view = registry.view<Portal>();
+		auto portal_view = world.registry.view<Portal>();
 		for (entt::entity portal_entity : portal_view) {
-			registry.destroy(portal_entity);
+			world.registry.destroy(portal_entity);
 		}
 		has_opening_portal_placed = false;
 
 		// Find the walls with portals and remove the portal
-		auto wall_view = registry.view<Wall>();
+		auto wall_view = world.registry.view<Wall>();
 		for (entt::entity wall_entity : wall_view) {
-			Wall &wall = registry.get<Wall>(wall_entity);
+			Wall &wall = world.registry.get<Wall>(wall_entity);
 			if (wall.has_portal) {
 				wall.has_portal = false;
 			}
 		}
+		world.map_system.updatePortalGraph(world.registry);
 	}
 }
 
@@ -1283,10 +1411,10 @@ std::tuple<Direction, vec2> WorldSystem::get_wall_collision_direction_and_positi
 		vec2 neighbouring_wall_position_top = wall_position + vec2(0, -GRID_CELL_HEIGHT_PX);
 		vec2 neighbouring_wall_position_bottom = wall_position + vec2(0, GRID_CELL_HEIGHT_PX);
 
-		auto wall_view = registry.view<Wall>();
+		auto wall_view = world.registry.view<Wall>();
 
 		for (entt::entity entity : wall_view) {
-			Motion &motion = registry.get<Motion>(entity);
+			Motion &motion = world.registry.get<Motion>(entity);
 			vec2 entity_position = motion.position;
 
 			if (entity_position == neighbouring_wall_position_left) {
@@ -1358,9 +1486,9 @@ std::tuple<Direction, vec2> WorldSystem::get_wall_collision_direction_and_positi
 	}
 }
 
-vec2 get_other_portal_position(entt::entity current_portal_entity) {
-	Portal &portal = registry.get<Portal>(current_portal_entity);
-	Portal &other_portal = registry.get<Portal>(portal.other_portal);
+vec2 WorldSystem::get_other_portal_position(entt::entity current_portal_entity) {
+	Portal &portal = world.registry.get<Portal>(current_portal_entity);
+	Portal &other_portal = world.registry.get<Portal>(portal.other_portal);
 
 	return other_portal.position;
 }
\ No newline at end of file
@@ -13,7 +13,13 @@
 
 #include <entt.hpp>
 
+#include "boids_system.hpp"
 #include "render_system.hpp"
+#include "input_replay.hpp"
+#include "tinyECS/command_buffer.hpp"
+#include "tinyECS/snapshot.hpp"
+#include "util/rng.hpp"
+#include "world.hpp"
 
 
 // Container for all our entities and game logic.
@@ -21,7 +27,7 @@
 class WorldSystem
 {
 public:
-	WorldSystem();
+	explicit WorldSystem(World& world);
 
 	// creates main window
 	GLFWwindow* create_window();
@@ -35,6 +41,18 @@ public:
 	// starts the game
 	void init(RenderSystem* renderer);
 
+	// skip the start screen and cutscenes and go straight into a level (headless runs)
+	void play_level(unsigned int level_index);
+
+	// every input event goes through here, from the window callbacks or from a replay
+	void apply_input(const InputEvent& event);
+
+	// record applied input (null to stop)
+	void set_input_recorder(InputRecorder* recorder) { input_recorder = recorder; }
+
+	// drop live window input, e.g. while a replay drives the game
+	void set_ignore_window_input(bool ignore) { ignore_window_input = ignore; }
+
 	void initUI(RenderSystem* renderer);
 
 	// releases all associated resources
@@ -62,7 +80,8 @@ public:
 
 	void handle_player_door_collisions(entt::entity entity1, entt::entity entity2);
 
-	// returns true if player has exited the level, false otherwise
+	// returns true if player has exited the level, false otherwise; the restart itself
+	// happens at the end of handle_collisions
 	bool handle_player_exit_collisions(entt::entity entity1, entt::entity entity2);
 
 	void handle_player_key_collisions(entt::entity entity1, entt::entity entity2);
@@ -110,13 +129,10 @@ public:
 
 	bool get_saved_level(const std::string& filename, unsigned int& level);
 
-	static bool can_teleport;
-    static entt::entity nearby_player_entity;
-    static entt::entity nearby_wall_entity;
-
 	bool clear_saved_level(const std::string& filename);
 
 private:
+	World& world;
 
 	float mouse_pos_x = 0.0f;
 	float mouse_pos_y = 0.0f;
@@ -127,6 +143,7 @@ private:
 	std::string world_level_filename = "saved_level.txt";
 
 	// input callback functions
+	void on_window_input(const InputEvent& event);
 	void on_key(int key, int, int action, int mod);
 	void on_mouse_move(vec2 pos);
 	void on_mouse_button_pressed(int button, int action, int mods);
@@ -134,11 +151,20 @@ private:
 	// player keyboard state tracker for movement
 	std::set<int> key_state;
 
+	InputRecorder* input_recorder = nullptr;
+	bool ignore_window_input = false;
+
 	// restart level
 	void restart_game();
 
-	// OpenGL window handle
-	GLFWwindow* window;
+	// structural changes from step() and handle_collisions(), applied at the end of each
+	CommandBuffer commands;
+	bool restart_pending = false;
+
+	BoidsSystem boids;
+
+	// OpenGL window handle, null when headless
+	GLFWwindow* window = nullptr;
 
 	int next_invader_spawn;
 	int invader_spawn_rate_ms;	// see default value in common.hpp
@@ -162,6 +188,14 @@ private:
 	unsigned int level;
 	void generate_level();
 
+	// the level as generate_level left it, so a restart skips the map load and pathfinding
+	Snapshot level_snapshot;
+	int snapshot_level = -1; // level held by level_snapshot, -1 for none
+	size_t snapshot_player = 0; // index of the player among the captured entities
+	int snapshot_portals = 0;
+	void capture_level();
+	void restore_level();
+
 	// cutscene
 	GAME_SCREEN_ID game_screen = GAME_SCREEN_ID::START_SCREEN;
 	int update_cutscene = 0;
@@ -170,12 +204,14 @@ private:
 	// grid
 	std::vector<entt::entity> grid_lines;
 
-	// music references
-	Mix_Music* background_music;
-	Mix_Chunk* chicken_dead_sound;
-	Mix_Chunk* chicken_eat_sound;
-	Mix_Chunk* key_collect_sound;
-	Mix_Chunk* portal_sound;
+	// music references, null when audio was never started (headless)
+	bool audio_open = false;
+	Mix_Music* background_music = nullptr;
+	Mix_Chunk* chicken_dead_sound = nullptr;
+	Mix_Chunk* chicken_eat_sound = nullptr;
+	Mix_Chunk* key_collect_sound = nullptr;
+	Mix_Chunk* portal_sound = nullptr;
+	void play_sound(Mix_Chunk* sound);
 
 	// text ui
 	TextRenderRequest *cheese_trr;
@@ -183,11 +219,13 @@ private:
 	TextRenderRequest *portal_charge_trr;
 	TextRenderRequest *level_text_trr;
 	TextRenderRequest *fps_trr;
+	TextRenderRequest *profile_trr;
+	bool show_profile = false;
 
 	entt::entity stats_ui;
 	entt::entity tutorial_ui;
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, seeded with the world's seed
+	Rng& rng = world.random.stream(RngStream::WORLD);
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 };